@@ -2,6 +2,7 @@
 #include "arp_message.hh"
 #include "bidirectional_stream_copy.hh"
 #include "exception.hh"
+#include "pcap_fd_adapter.hh"
 #include "router.hh"
 #include "tcp_minnow_socket.cc"
 #include "tcp_over_ip.hh"
@@ -9,6 +10,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -89,12 +91,15 @@ private:
   NetworkInterface _interface;
   Address _next_hop;
   pair<FileDescriptor, FileDescriptor> _data_socket_pair = socket_pair_helper( SOCK_DGRAM );
+  vector<EthernetFrame> _outbound {};
 
   void send_pending()
   {
-    while ( auto frame = _interface.maybe_send() ) {
-      _data_socket_pair.first.write( serialize( frame.value() ) );
+    _interface.drain_frames( _outbound );
+    for ( const auto& frame : _outbound ) {
+      _data_socket_pair.first.write( serialize( frame ) );
     }
+    _outbound.clear();
   }
 
 public:
@@ -128,24 +133,37 @@ public:
     _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
     send_pending();
   }
+  void write( vector<TCPSegment>& segs )
+  {
+    for ( auto& seg : segs ) {
+      _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+    }
+    send_pending();
+  }
   void tick( const size_t ms_since_last_tick )
   {
     _interface.tick( ms_since_last_tick );
     send_pending();
   }
+  void set_config( const FdAdapterConfig& cfg )
+  {
+    FdAdapterBase::set_config( cfg );
+    _interface.set_mtu( cfg.mtu );
+  }
   NetworkInterface& interface() { return _interface; }
 
   FileDescriptor& fd() { return _data_socket_pair.first; }
   FileDescriptor& frame_fd() { return _data_socket_pair.second; }
 };
 
-class TCPSocketEndToEnd : public TCPMinnowSocket<NetworkInterfaceAdapter>
+class TCPSocketEndToEnd : public TCPMinnowSocket<PcapFdAdapter<NetworkInterfaceAdapter>>
 {
   Address _local_address;
 
 public:
-  TCPSocketEndToEnd( const Address& ip_address, const Address& next_hop )
-    : TCPMinnowSocket<NetworkInterfaceAdapter>( NetworkInterfaceAdapter( ip_address, next_hop ) )
+  TCPSocketEndToEnd( const Address& ip_address, const Address& next_hop, const string& pcap_path )
+    : TCPMinnowSocket<PcapFdAdapter<NetworkInterfaceAdapter>>(
+      PcapFdAdapter( NetworkInterfaceAdapter( ip_address, next_hop ), pcap_path ) )
     , _local_address( ip_address )
   {}
 
@@ -158,7 +176,7 @@ public:
     multiplexer_config.source = _local_address;
     multiplexer_config.destination = address;
 
-    TCPMinnowSocket<NetworkInterfaceAdapter>::connect( {}, multiplexer_config );
+    TCPMinnowSocket<PcapFdAdapter<NetworkInterfaceAdapter>>::connect( {}, multiplexer_config );
   }
 
   void bind( const Address& address )
@@ -173,14 +191,20 @@ public:
   {
     FdAdapterConfig multiplexer_config;
     multiplexer_config.source = _local_address;
-    TCPMinnowSocket<NetworkInterfaceAdapter>::listen_and_accept( {}, multiplexer_config );
+    TCPMinnowSocket<PcapFdAdapter<NetworkInterfaceAdapter>>::listen_and_accept( {}, multiplexer_config );
   }
 
-  NetworkInterfaceAdapter& adapter() { return _datagram_adapter; }
+  NetworkInterfaceAdapter& adapter() { return _datagram_adapter.adapter(); }
 };
 
+static constexpr uint64_t ARP_REFRESH_LEAD_MS = 5000;
+
 // NOLINTBEGIN(*-cognitive-complexity)
-void program_body( bool is_client, const string& bounce_host, const string& bounce_port, const bool debug )
+void program_body( bool is_client,
+                   const string& bounce_host,
+                   const string& bounce_port,
+                   const bool debug,
+                   const string& pcap_path )
 {
   UDPSocket internet_socket;
   Address bounce_address { bounce_host, bounce_port };
@@ -212,14 +236,25 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
   }
 
   /* set up the client */
-  TCPSocketEndToEnd sock = is_client ? TCPSocketEndToEnd { Address { "192.168.0.50" }, Address { "192.168.0.1" } }
-                                     : TCPSocketEndToEnd { Address { "172.16.0.100" }, Address { "172.16.0.1" } };
+  const Address host_ip { is_client ? "192.168.0.50" : "172.16.0.100" };
+  const Address gateway_ip { is_client ? "192.168.0.1" : "172.16.0.1" };
+  TCPSocketEndToEnd sock { host_ip, gateway_ip, pcap_path };
+
+  /* the host and its router know each other from the start; mappings to the other router are kept fresh */
+  sock.adapter().interface().add_static_neighbor( gateway_ip, router.interface( host_side ).ethernet_address() );
+  router.interface( host_side ).add_static_neighbor( host_ip, sock.adapter().interface().ethernet_address() );
+  router.interface( internet_side ).set_arp_refresh( ARP_REFRESH_LEAD_MS );
 
   atomic<bool> exit_flag {};
 
   queue<EthernetFrame> router_to_host;
   queue<EthernetFrame> router_to_internet;
 
+  // Frames that arrived during one pass of the event loop, handed to the router together
+  vector<EthernetFrame> host_to_router;
+  vector<EthernetFrame> internet_to_router;
+  vector<EthernetFrame> outbound;
+
   /* set up the network */
   thread network_thread( [&]() {
     try {
@@ -234,8 +269,7 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
         if ( debug ) {
           cerr << "     Host->router:     " << summary( frame ) << "\n";
         }
-        router.interface( host_side ).recv_frame( frame );
-        router.route();
+        host_to_router.push_back( move( frame ) );
       } );
 
       // Frames from router to host
@@ -278,23 +312,33 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
         if ( debug ) {
           cerr << "     Internet->router: " << summary( frame ) << "\n";
         }
-        router.interface( internet_side ).recv_frame( frame );
-        router.route();
+        internet_to_router.push_back( move( frame ) );
       } );
 
+      auto drain = [&]( AsyncNetworkInterface& interface, queue<EthernetFrame>& to ) {
+        interface.drain_frames( outbound );
+        for ( auto& frame : outbound ) {
+          to.push( move( frame ) );
+        }
+        outbound.clear();
+      };
+
       while ( true ) {
         if ( EventLoop::Result::Exit == event_loop.wait_next_event( 10 ) ) {
           cerr << "Exiting...\n";
           return;
         }
+        if ( not host_to_router.empty() or not internet_to_router.empty() ) {
+          router.interface( host_side ).recv_frames( host_to_router );
+          router.interface( internet_side ).recv_frames( internet_to_router );
+          host_to_router.clear();
+          internet_to_router.clear();
+          router.route();
+        }
         router.interface( host_side ).tick( 10 );
         router.interface( internet_side ).tick( 10 );
-        while ( auto frame = router.interface( host_side ).maybe_send() ) {
-          router_to_host.push( move( frame.value() ) );
-        }
-        while ( auto frame = router.interface( internet_side ).maybe_send() ) {
-          router_to_internet.push( move( frame.value() ) );
-        }
+        drain( router.interface( host_side ), router_to_host );
+        drain( router.interface( internet_side ), router_to_internet );
 
         if ( exit_flag ) {
           return;
@@ -328,8 +372,8 @@ void program_body( bool is_client, const string& bounce_host, const string& boun
 
 void print_usage( const string& argv0 )
 {
-  cerr << "Usage: " << argv0 << " client HOST PORT [debug]\n";
-  cerr << "or     " << argv0 << " server HOST PORT [debug]\n";
+  cerr << "Usage: " << argv0 << " client HOST PORT [debug] [pcap FILE]\n";
+  cerr << "or     " << argv0 << " server HOST PORT [debug] [pcap FILE]\n";
 }
 
 int main( int argc, char* argv[] )
@@ -345,17 +389,25 @@ int main( int argc, char* argv[] )
       abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
     }
 
-    if ( argc != 4 and argc != 5 ) {
+    if ( argc < 4 or ( args[1] != "client"s and args[1] != "server"s ) ) {
       print_usage( args[0] );
       return EXIT_FAILURE;
     }
 
-    if ( args[1] != "client"s and args[1] != "server"s ) {
-      print_usage( args[0] );
-      return EXIT_FAILURE;
+    bool debug = false;
+    string pcap_path;
+    for ( size_t i = 4; i < args.size(); i++ ) {
+      if ( args[i] == "debug"s ) {
+        debug = true;
+      } else if ( args[i] == "pcap"s and i + 1 < args.size() ) {
+        pcap_path = args[++i];
+      } else {
+        print_usage( args[0] );
+        return EXIT_FAILURE;
+      }
     }
 
-    program_body( args[1] == "client"s, args[2], args[3], argc == 5 );
+    program_body( args[1] == "client"s, args[2], args[3], debug, pcap_path );
   } catch ( const exception& e ) {
     cerr << e.what() << "\n";
     return EXIT_FAILURE;
@@ -16,6 +16,7 @@ using namespace std;
 
 constexpr const char* TUN_DFLT = "tun144";
 constexpr const char* LOCAL_ADDRESS_DFLT = "169.254.144.9";
+constexpr size_t TRACE_EVENTS = 64 * 1024;
 
 static void show_usage( const char* argv0, const char* msg )
 {
@@ -32,6 +33,9 @@ static void show_usage( const char* argv0, const char* msg )
        << "   -w <winsz>      Use a window of <winsz> bytes                   " << TCPConfig::MAX_PAYLOAD_SIZE
        << "\n\n"
 
+       << "   -m <mtu>        Set the MTU (up to " << EthernetHeader::MAX_MTU << " for jumbo frames)      "
+       << EthernetHeader::DEFAULT_MTU << "\n\n"
+
        << "   -t <tmout>      Set rt_timeout to tmout                         " << TCPConfig::TIMEOUT_DFLT << "\n\n"
 
        << "   -d <tundev>     Connect to tun <tundev>                         " << TUN_DFLT << "\n\n"
@@ -39,6 +43,12 @@ static void show_usage( const char* argv0, const char* msg )
        << "   -Lu <loss>      Set uplink loss to <rate> (float in 0..1)       (no loss)\n"
        << "   -Ld <loss>      Set downlink loss to <rate> (float in 0..1)     (no loss)\n\n"
 
+       << "   -P <file>       Capture the connection's datagrams to the      (no capture)\n"
+       << "                   pcap file <file>\n\n"
+
+       << "   -T <file>       Trace the connection's events, and dump them    (no trace)\n"
+       << "                   to <file> if it fails (see tcp_trace_decode)\n\n"
+
        << "   -h              Show this message.\n\n";
 
   if ( msg != nullptr ) {
@@ -55,11 +65,12 @@ static void check_argc( const span<char*>& args, size_t curr, const char* err )
   }
 }
 
-static tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const span<char*>& args )
+static tuple<TCPConfig, FdAdapterConfig, bool, const char*, string> get_config( const span<char*>& args )
 {
   TCPConfig c_fsm {};
   FdAdapterConfig c_filt {};
   const char* tundev = nullptr;
+  string pcap_path;
 
   size_t curr = 1;
   bool listen = false;
@@ -88,6 +99,16 @@ static tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const sp
       c_fsm.recv_capacity = strtol( args[curr + 1], nullptr, 0 );
       curr += 2;
 
+    } else if ( strncmp( "-m", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -m requires one argument." );
+      const long mtu = strtol( args[curr + 1], nullptr, 0 );
+      if ( mtu < 68 or mtu > static_cast<long>( EthernetHeader::MAX_MTU ) ) {
+        show_usage( args[0], "ERROR: MTU out of range." );
+        exit( 1 );
+      }
+      c_filt.mtu = static_cast<uint16_t>( mtu );
+      curr += 2;
+
     } else if ( strncmp( "-t", args[curr], 3 ) == 0 ) {
       check_argc( args, curr, "ERROR: -t requires one argument." );
       c_fsm.rt_timeout = strtol( args[curr + 1], nullptr, 0 );
@@ -114,6 +135,17 @@ static tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const sp
         = static_cast<LossRateDnT>( static_cast<float>( numeric_limits<LossRateDnT>::max() ) * lossrate );
       curr += 2;
 
+    } else if ( strncmp( "-P", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -P requires one argument." );
+      pcap_path = args[curr + 1];
+      curr += 2;
+
+    } else if ( strncmp( "-T", args[curr], 3 ) == 0 ) {
+      check_argc( args, curr, "ERROR: -T requires one argument." );
+      c_fsm.trace_events = TRACE_EVENTS;
+      c_fsm.trace_path = args[curr + 1];
+      curr += 2;
+
     } else if ( strncmp( "-h", args[curr], 3 ) == 0 ) {
       show_usage( args[0], nullptr );
       exit( 0 );
@@ -136,7 +168,7 @@ static tuple<TCPConfig, FdAdapterConfig, bool, const char*> get_config( const sp
     c_filt.source = { source_address, source_port };
   }
 
-  return make_tuple( c_fsm, c_filt, listen, tundev );
+  return make_tuple( c_fsm, c_filt, listen, tundev, pcap_path );
 }
 
 int main( int argc, char** argv )
@@ -153,9 +185,9 @@ int main( int argc, char** argv )
       return EXIT_FAILURE;
     }
 
-    auto [c_fsm, c_filt, listen, tun_dev_name] = get_config( args );
-    LossyTCPOverIPv4MinnowSocket tcp_socket( LossyTCPOverIPv4OverTunFdAdapter(
-      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ) ) );
+    auto [c_fsm, c_filt, listen, tun_dev_name, pcap_path] = get_config( args );
+    LossyPcapTCPOverIPv4MinnowSocket tcp_socket( LossyPcapTCPOverIPv4OverTunFdAdapter( PcapFdAdapter(
+      TCPOverIPv4OverTunFdAdapter( TunFD( tun_dev_name == nullptr ? TUN_DFLT : tun_dev_name ) ), pcap_path ) ) );
 
     if ( listen ) {
       tcp_socket.listen_and_accept( c_fsm, c_filt );
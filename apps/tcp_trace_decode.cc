@@ -0,0 +1,62 @@
+#include "tcp_trace.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <span>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+// Print a dump written by TCPTrace::dump(), one event per line, with times relative to the first event
+void program_body( const string& path )
+{
+  ifstream file { path, ios::binary };
+  if ( not file ) {
+    throw runtime_error( "could not open " + path );
+  }
+  stringstream contents;
+  contents << file.rdbuf();
+
+  uint64_t recorded = 0;
+  const auto events = TCPTrace::parse( contents.str(), recorded );
+  cout << events.size() << " events";
+  if ( recorded > events.size() ) {
+    cout << " (the latest of " << recorded << ")";
+  }
+  cout << "\n";
+
+  cout << setw( 14 ) << "time (ms)" << "  " << left << setw( 14 ) << "event" << right << setw( 12 ) << "seqno"
+       << setw( 10 ) << "length" << setw( 12 ) << "value" << "\n";
+  for ( const auto& e : events ) {
+    const uint64_t since_us = ( e.time_ns - events.front().time_ns ) / 1000;
+    cout << setw( 10 ) << since_us / 1000 << "." << setfill( '0' ) << setw( 3 ) << since_us % 1000
+         << setfill( ' ' ) << "  " << left << setw( 14 ) << TCPTrace::kind_name( e.kind ) << right << setw( 12 )
+         << e.seqno << setw( 10 ) << e.length << setw( 12 ) << e.value << "\n";
+  }
+}
+
+int main( int argc, char* argv[] )
+{
+  try {
+    if ( argc <= 0 ) {
+      abort(); // For sticklers: don't try to access argv[0] if argc <= 0.
+    }
+
+    auto args = span( argv, argc );
+
+    if ( argc != 2 ) {
+      cerr << "Usage: " << args.front() << " TRACE_FILE\n";
+      return EXIT_FAILURE;
+    }
+
+    program_body( args[1] );
+  } catch ( const exception& e ) {
+    cerr << e.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
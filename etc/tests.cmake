@@ -53,11 +53,39 @@ ttest(send_window)
 ttest(send_ack)
 ttest(send_close)
 ttest(send_extra)
+ttest(send_rack)
+ttest(send_ecn)
+ttest(send_batch)
 
 ttest(net_interface)
 
 ttest(router)
 
+ttest(timer_wheel)
+
+ttest(tcp_options)
+
+ttest(tcp_connection_table)
+
+ttest(tcp_listener)
+
+ttest(tcp_stats)
+
+ttest(tcp_peer_batch)
+ttest(tcp_peer_timestamps)
+ttest(tcp_peer_window_scale)
+ttest(tcp_peer_mss)
+ttest(tcp_peer_delayed_ack)
+ttest(tcp_peer_autotune)
+ttest(tcp_peer_window)
+ttest(tcp_peer_ecn)
+
+ttest(pcap_fd_adapter)
+
+ttest(neighbor_table)
+
+ttest(prefix_table)
+
 add_custom_target (check0 COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --stop-on-failure --timeout 12 -R 'webget|^byte_stream_')
 
 add_custom_target (check_webget COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure --timeout 12 -R 'webget')
@@ -90,3 +118,5 @@ set_tests_properties(${compile_name_opt} PROPERTIES FIXTURES_SETUP compile_opt)
 
 stest(byte_stream_speed_test)
 stest(reassembler_speed_test)
+stest(tcp_options_speed_test)
+stest(route_load_speed_test)
@@ -6,10 +6,27 @@ using namespace std;
 
 ByteStream::ByteStream( uint64_t capacity ) : capacity_( capacity ), buffer(), read_index() {}
 
+void ByteStream::set_capacity( uint64_t capacity )
+{
+  capacity_ = capacity;
+
+  // Give back memory held by popped bytes, or reserved for a larger capacity
+  if ( buffer.capacity() > capacity_ + cur_size ) {
+    buffer.erase( 0, read_index );
+    buffer.shrink_to_fit();
+    read_index = 0;
+  }
+}
+
+uint64_t ByteStream::capacity() const
+{
+  return capacity_;
+}
+
 void Writer::push( string data )
 {
   // Your code here.
-  uint64_t accept_size = min( capacity_ - cur_size, data.size() );
+  uint64_t accept_size = min( available_capacity(), data.size() );
 
   if ( !accept_size )
     return;
@@ -43,7 +60,7 @@ bool Writer::is_closed() const
 uint64_t Writer::available_capacity() const
 {
   // Your code here.
-  return capacity_ - cur_size;
+  return capacity_ > cur_size ? capacity_ - cur_size : 0;
 }
 
 uint64_t Writer::bytes_pushed() const
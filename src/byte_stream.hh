@@ -25,6 +25,11 @@ protected:
 public:
   explicit ByteStream( uint64_t capacity );
 
+  // Resize the stream (e.g. receive-buffer autotuning), releasing memory no longer needed. Shrinking
+  // below the bytes buffered keeps them, but nothing more can be pushed until enough have been popped.
+  void set_capacity( uint64_t capacity );
+  uint64_t capacity() const;
+
   // Helper functions (provided) to access the ByteStream's Reader and Writer interfaces
   Reader& reader();
   const Reader& reader() const;
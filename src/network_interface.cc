@@ -11,7 +11,7 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
   : ethernet_address_( ethernet_address )
   , ip_address_( ip_address )
   , ARP_REQUEST_HEADER( { .dst = ETHERNET_BROADCAST, .src = ethernet_address, .type = EthernetHeader::TYPE_ARP } )
-  , meta_ip2eth( make_shared<unordered_map<uint32_t, IP2ETH_STATES>>() )
+  , IPV4_HEADER( { .dst = {}, .src = ethernet_address, .type = EthernetHeader::TYPE_IPv4 } )
 {
   cerr << "DEBUG: Network interface has Ethernet address " << to_string( ethernet_address_ ) << " and IP address "
        << ip_address.ip() << "\n";
@@ -25,11 +25,26 @@ NetworkInterface::NetworkInterface( const EthernetAddress& ethernet_address, con
 // Address::ipv4_numeric() method.
 void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Address& next_hop )
 {
+  if ( dgram.header.len > mtu_ ) {
+    // Say so the first time: a TCP MSS that does not fit the MTU otherwise stalls the connection silently
+    if ( oversized_dropped_++ == 0 )
+      cerr << "DEBUG: Network interface dropped a " << dgram.header.len << "-byte datagram, over its MTU of "
+           << mtu_ << "\n";
+    return;
+  }
+
   const auto ip = next_hop.ipv4_numeric();
-  IP2ETH_STATES& meta = ( *meta_ip2eth )[ip];
+  NeighborTable::Neighbor* neighbor = neighbors_.find( ip );
+
+  if ( neighbor != nullptr && neighbor->state != NeighborTable::State::Incomplete ) {
+    if ( neighbor->state != NeighborTable::State::Static )
+      neighbor->flags |= NEIGHBOR_USED;
+    push_ipv4_frame( neighbor->ethernet_address, dgram );
+    return;
+  }
 
   // Send ARP
-  if ( meta == IP2ETH_NONE ) {
+  if ( neighbor == nullptr ) {
     ARPMessage payload = {
       .opcode = ARPMessage::OPCODE_REQUEST,
       .sender_ethernet_address = ethernet_address_,
@@ -42,25 +57,158 @@ void NetworkInterface::send_datagram( const InternetDatagram& dgram, const Addre
       .payload = serialize( move( payload ) ),
     };
     pendings.push_back( move( frame ) );
-    meta = IP2ETH_ARP_SENT;
-    timer.set_event<Timer::TIMER_ARP_TIMEOUT>( ARP_DEFAULT_TIMEOUT_MS, ip );
+    neighbor = &neighbors_.emplace( ip );
+    neighbors_.set_deadline( *neighbor, now_ms_ + ARP_DEFAULT_TIMEOUT_MS );
+  }
+
+  if ( neighbor->queue == NeighborTable::NO_QUEUE ) {
+    if ( free_waitings.empty() ) {
+      neighbor->queue = static_cast<uint32_t>( waitings.size() );
+      waitings.emplace_back();
+    } else {
+      neighbor->queue = free_waitings.back();
+      free_waitings.pop_back();
+    }
+  }
+  auto& queue = waitings[neighbor->queue];
+  if ( queue.size() >= pending_limit_ ) {
+    pending_stats_.dropped_overflow++;
+    if ( pending_policy_ == PendingPolicy::DropTail )
+      return;
+    queue.pop_front();
   }
+  queue.push_back( dgram );
+  pending_stats_.queued++;
+}
+
+// Queue a frame carrying `dgram`: its IPv4 header is encoded into a buffer of its own, and the frame shares the
+// datagram's payload buffers rather than copying them
+void NetworkInterface::push_ipv4_frame( const EthernetAddress& dst, const InternetDatagram& dgram )
+{
+  string header;
+  header.reserve( IPv4Header::LENGTH );
+  Serializer serializer { move( header ) };
+  dgram.serialize( serializer );
+
+  EthernetFrame& frame = pendings.emplace_back( IPV4_HEADER, serializer.output() );
+  frame.header.dst = dst;
+}
+
+void NetworkInterface::release_waiting( NeighborTable::Neighbor& neighbor )
+{
+  if ( neighbor.queue == NeighborTable::NO_QUEUE )
+    return;
+  waitings[neighbor.queue].clear();
+  free_waitings.push_back( neighbor.queue );
+  neighbor.queue = NeighborTable::NO_QUEUE;
+}
+
+// Learn (or refresh) a neighbor's mapping, sending anything that was waiting for it
+void NetworkInterface::learn( const uint32_t ip, const EthernetAddress& ethernet_address )
+{
+  NeighborTable::Neighbor& neighbor = neighbors_.emplace( ip );
+  if ( neighbor.state == NeighborTable::State::Static )
+    return;
+  neighbor.ethernet_address = ethernet_address;
+  confirm( neighbor );
+  flush_waiting( neighbor );
+}
+
+// The neighbor's mapping is good for another IP2ETH_MAPPING_TIMEOUT_MS
+void NetworkInterface::confirm( NeighborTable::Neighbor& neighbor )
+{
+  neighbor.state = NeighborTable::State::Reachable;
+  neighbor.flags = 0;
+  neighbors_.set_deadline( neighbor, now_ms_ + IP2ETH_MAPPING_TIMEOUT_MS - arp_refresh_lead_ms_ );
+}
 
-  EthernetHeader header = {
-    .dst = ip2eth[ip],
-    .src = ethernet_address_,
-    .type = EthernetHeader::TYPE_IPv4,
-  };
-  EthernetFrame frame = {
-    .header = move( header ),
-    .payload = serialize( dgram ),
-  };
-
-  if ( meta == IP2ETH_VALID ) {
-    pendings.emplace_back( move( frame ) );
-  } else {
-    waitings[ip] = frame;
+void NetworkInterface::flush_waiting( NeighborTable::Neighbor& neighbor )
+{
+  if ( neighbor.queue == NeighborTable::NO_QUEUE )
+    return;
+  auto& queue = waitings[neighbor.queue];
+  for ( const auto& dgram : queue ) {
+    push_ipv4_frame( neighbor.ethernet_address, dgram );
   }
+  pending_stats_.flushed += queue.size();
+  release_waiting( neighbor );
+}
+
+void NetworkInterface::on_deadline( NeighborTable::Neighbor& neighbor )
+{
+  using State = NeighborTable::State;
+  switch ( neighbor.state ) {
+    case State::Static:
+      return;
+    case State::Reachable:
+      if ( arp_refresh_lead_ms_ == 0 )
+        break;
+      neighbor.state = State::Stale;
+      neighbor.flags &= NEIGHBOR_USED; // no probes sent yet
+      [[fallthrough]];
+    case State::Stale: {
+      const auto probes = static_cast<uint8_t>( neighbor.flags & ~NEIGHBOR_USED );
+      if ( probes == ARP_REFRESH_PROBES )
+        break;
+      if ( neighbor.flags & NEIGHBOR_USED ) {
+        ARPMessage probe = {
+          .opcode = ARPMessage::OPCODE_REQUEST,
+          .sender_ethernet_address = ethernet_address_,
+          .sender_ip_address = ip_address_.ipv4_numeric(),
+          .target_ethernet_address = {},
+          .target_ip_address = neighbor.ip,
+        };
+        pendings.push_back( {
+          .header = {
+            .dst = neighbor.ethernet_address,
+            .src = ethernet_address_,
+            .type = EthernetHeader::TYPE_ARP,
+          },
+          .payload = serialize( move( probe ) ),
+        } );
+      }
+      neighbor.flags++;
+      neighbors_.set_deadline( neighbor, neighbor.deadline + arp_refresh_lead_ms_ / ARP_REFRESH_PROBES );
+      return;
+    }
+    default:
+      break;
+  }
+  forget( neighbor );
+}
+
+// A neighbor's ARP request went unanswered, or its mapping aged out: forget it, so the next datagram re-ARPs
+void NetworkInterface::forget( NeighborTable::Neighbor& neighbor )
+{
+  if ( neighbor.queue != NeighborTable::NO_QUEUE ) {
+    pending_stats_.dropped_unresolved += waitings[neighbor.queue].size();
+    release_waiting( neighbor );
+  }
+  neighbors_.erase( neighbor.ip );
+}
+
+void NetworkInterface::set_arp_refresh( const uint64_t lead_ms )
+{
+  if ( lead_ms >= IP2ETH_MAPPING_TIMEOUT_MS )
+    throw runtime_error( "NetworkInterface: ARP refresh must start before the mapping expires" );
+  arp_refresh_lead_ms_ = lead_ms;
+}
+
+void NetworkInterface::add_static_neighbor( const Address& ip, const EthernetAddress& ethernet_address )
+{
+  NeighborTable::Neighbor& neighbor = neighbors_.emplace( ip.ipv4_numeric() );
+  neighbor.state = NeighborTable::State::Static;
+  neighbor.ethernet_address = ethernet_address;
+  neighbor.deadline = 0;
+  flush_waiting( neighbor );
+}
+
+void NetworkInterface::set_pending_limit( const size_t limit, const PendingPolicy policy )
+{
+  if ( limit == 0 )
+    throw runtime_error( "NetworkInterface: pending limit must be at least 1" );
+  pending_limit_ = limit;
+  pending_policy_ = policy;
 }
 
 // frame: the incoming Ethernet frame
@@ -86,8 +234,14 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
       if ( !parse( ret, payload ) )
         break;
 
-      ip2eth[ret.header.src] = header.src;
-      timer.set_event<Timer::TIMER_IP2ETH_REFRESH>( IP2ETH_MAPPING_TIMEOUT_MS, ret.header.src );
+      // A datagram from a resolved neighbor refreshes its mapping
+      NeighborTable::Neighbor* neighbor = neighbors_.find( ret.header.src );
+      if ( neighbor != nullptr
+           && ( neighbor->state == NeighborTable::State::Reachable
+                || neighbor->state == NeighborTable::State::Stale ) ) {
+        neighbor->ethernet_address = header.src;
+        confirm( *neighbor );
+      }
       return ret;
     }
     default:
@@ -100,18 +254,44 @@ optional<InternetDatagram> NetworkInterface::recv_frame( const EthernetFrame& fr
 // ms_since_last_tick: the number of milliseconds since the last call to this method
 void NetworkInterface::tick( const size_t ms_since_last_tick )
 {
-  timer.elapse( ms_since_last_tick );
+  now_ms_ += ms_since_last_tick;
+  neighbors_.expire( now_ms_, [this]( NeighborTable::Neighbor& neighbor ) { on_deadline( neighbor ); } );
+}
+
+void NetworkInterface::set_mtu( const size_t mtu )
+{
+  if ( mtu < 68 || mtu > EthernetHeader::MAX_MTU )
+    throw runtime_error( "NetworkInterface: MTU out of range: " + to_string( mtu ) );
+  mtu_ = mtu;
 }
 
 optional<EthernetFrame> NetworkInterface::maybe_send()
 {
   if ( pendings.empty() )
     return nullopt;
-  const auto ret = pendings.front();
+  auto ret = move( pendings.front() );
   pendings.pop_front();
   return ret;
 }
 
+size_t NetworkInterface::drain_frames( vector<EthernetFrame>& frames )
+{
+  const size_t count = pendings.size();
+  frames.insert( frames.end(), make_move_iterator( pendings.begin() ), make_move_iterator( pendings.end() ) );
+  pendings.clear();
+  return count;
+}
+
+size_t NetworkInterface::recv_frames( span<const EthernetFrame> frames, vector<InternetDatagram>& datagrams )
+{
+  const size_t before = datagrams.size();
+  for ( const auto& frame : frames ) {
+    if ( auto dgram = recv_frame( frame ) )
+      datagrams.push_back( move( *dgram ) );
+  }
+  return datagrams.size() - before;
+}
+
 void NetworkInterface::ARP_handler( [[maybe_unused]] const EthernetHeader& header,
                                     const decltype( EthernetFrame::payload )& payload )
 {
@@ -119,17 +299,10 @@ void NetworkInterface::ARP_handler( [[maybe_unused]] const EthernetHeader& heade
   if ( !parse( msg, payload ) )
     return;
 
-  ( *meta_ip2eth )[msg.sender_ip_address] = IP2ETH_VALID;
-  ip2eth[msg.sender_ip_address] = msg.sender_ethernet_address;
-  timer.set_event<Timer::TIMER_IP2ETH_REFRESH>( IP2ETH_MAPPING_TIMEOUT_MS, msg.sender_ip_address );
+  learn( msg.sender_ip_address, msg.sender_ethernet_address );
 
   switch ( msg.opcode ) {
     case ARPMessage::OPCODE_REPLY:
-      if ( waitings.count( msg.sender_ip_address ) ) {
-        auto& f = waitings[msg.sender_ip_address];
-        f.header.dst = msg.sender_ethernet_address;
-        pendings.push_back( f );
-      }
       break;
     case ARPMessage::OPCODE_REQUEST: {
       if ( msg.target_ip_address != ip_address_.ipv4_numeric() )
@@ -4,6 +4,7 @@
 #include "arp_message.hh"
 #include "ethernet_frame.hh"
 #include "ipv4_datagram.hh"
+#include "neighbor_table.hh"
 
 #include <functional>
 #include <iostream>
@@ -11,6 +12,7 @@
 #include <memory>
 #include <optional>
 #include <queue>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -39,78 +41,29 @@ constexpr bool ETHERNET_DEBUG = false;
 // and learns or replies as necessary.
 class NetworkInterface
 {
-  enum IP2ETH_STATES
+public:
+  // What to do with a datagram for a next hop whose queue of datagrams awaiting ARP resolution is full
+  enum class PendingPolicy
   {
-    IP2ETH_NONE,
-    IP2ETH_ARP_SENT,
-    IP2ETH_VALID
+    DropTail,  // drop the new datagram
+    DropOldest // drop the datagram at the head of the queue, and queue the new one
   };
-  class Timer
+
+  struct PendingStats
   {
-  public:
-    enum EVENT_TYPES
-    {
-      TIMER_NO_EVENT = 0,
-      TIMER_IP2ETH_REFRESH = 1,
-      TIMER_ARP_TIMEOUT = 2
-    };
-
-  private:
-    size_t time_elapse = 0;
-
-    using event_pair_t = std::pair<uint64_t, EVENT_TYPES>;
-    std::unordered_map<uint32_t, event_pair_t> events {};
-    std::shared_ptr<std::unordered_map<uint32_t, IP2ETH_STATES>> meta;
-
-  public:
-    Timer( decltype( meta ) _m ) : meta( _m ) {}
-    Timer& elapse( const size_t ms )
-    {
-      time_elapse += ms;
-      // std::vector<uint32_t> ip_removals;
-
-      for ( auto [ip, pair] : events ) {
-        auto [t, _] = pair;
-        if ( t <= time_elapse ) {
-          ( *meta )[ip] = IP2ETH_NONE;
-          // ip_removals.emplace_back( ip );
-        }
-      }
-      // for ( auto ip : ip_removals )
-      //   events.erase( ip );
-      if ( events.empty() ) {
-        events.clear();
-        time_elapse = 0;
-      }
-
-      return *this;
-    }
-    template<EVENT_TYPES event_type>
-    Timer& set_event( const size_t period, const uint32_t ip )
-    {
-      if constexpr ( event_type == TIMER_IP2ETH_REFRESH ) {
-        events[ip] = { period + time_elapse, TIMER_IP2ETH_REFRESH };
-      } else if constexpr ( event_type == TIMER_NO_EVENT ) {
-        events.erase( ip );
-      } else {
-        switch ( events[ip].second ) {
-          case TIMER_ARP_TIMEOUT:
-          case TIMER_NO_EVENT:
-            events[ip].first = period + time_elapse;
-            break;
-          default:
-            if constexpr ( ETHERNET_DEBUG )
-              throw std::runtime_error( "Inconsist Timer events: time-" + std::to_string( events[ip].first )
-                                        + "type" + std::to_string( events[ip].second ) );
-        }
-      }
-      return *this;
-    }
+    uint64_t queued;             // datagrams that had to wait for ARP resolution
+    uint64_t flushed;            // ... and were sent once it arrived
+    uint64_t dropped_overflow;   // ... or were dropped because their next hop's queue was full
+    uint64_t dropped_unresolved; // ... or because the ARP request went unanswered
   };
 
+  static constexpr size_t DEFAULT_PENDING_LIMIT = 64;
+
 private:
   static constexpr uint64_t ARP_DEFAULT_TIMEOUT_MS = 5 * 1000;
   static constexpr uint64_t IP2ETH_MAPPING_TIMEOUT_MS = 30 * 1000;
+  static constexpr uint8_t ARP_REFRESH_PROBES = 3;
+  static constexpr uint8_t NEIGHBOR_USED = 0x80; // Neighbor::flags: sent to since it was last confirmed
 
   // Ethernet (known as hardware, network-access, or link-layer) address of the interface
   EthernetAddress ethernet_address_;
@@ -118,16 +71,36 @@ private:
   // IP (known as Internet-layer or network-layer) address of the interface
   Address ip_address_;
   EthernetHeader ARP_REQUEST_HEADER;
+  EthernetHeader IPV4_HEADER; // with dst to be filled in
+
+  // Largest datagram (IP header included) we put in a frame; up to EthernetHeader::MAX_MTU for jumbo frames
+  size_t mtu_ = EthernetHeader::DEFAULT_MTU;
+  uint64_t oversized_dropped_ = 0; // datagrams send_datagram() dropped for exceeding mtu_
 
 private:
-  std::shared_ptr<std::unordered_map<uint32_t, IP2ETH_STATES>> meta_ip2eth;
-  std::unordered_map<uint32_t, EthernetAddress> ip2eth {};
+  // Every neighbor we have resolved or are resolving. An Incomplete neighbor's deadline is its ARP timeout, a
+  // Reachable one's is when its mapping expires (or, with ARP refresh on, when it turns Stale), a Stale one's
+  // is its next unicast ARP probe (or expiry, after the last). Static neighbors have none.
+  NeighborTable neighbors_ {};
+  uint64_t now_ms_ = 0;
+  uint64_t arp_refresh_lead_ms_ = 0;
   void ARP_handler( const EthernetHeader&, const decltype( EthernetFrame::payload )& );
-
-  std::deque<EthernetFrame> pendings {};                   // pkt to send
-  std::unordered_map<uint32_t, EthernetFrame> waitings {}; // IP dgram waiting MAC
-
-  Timer timer { meta_ip2eth };
+  void learn( uint32_t ip, const EthernetAddress& ethernet_address );
+  void confirm( NeighborTable::Neighbor& neighbor );
+  void flush_waiting( NeighborTable::Neighbor& neighbor );
+  void on_deadline( NeighborTable::Neighbor& neighbor );
+  void forget( NeighborTable::Neighbor& neighbor );
+
+  std::deque<EthernetFrame> pendings {}; // pkt to send
+  // Datagrams waiting for their next hop's MAC, in the order sent; serialized only once they can be sent.
+  // A neighbor names its queue by index; queues of forgotten neighbors are kept for reuse.
+  std::vector<std::deque<InternetDatagram>> waitings {};
+  std::vector<uint32_t> free_waitings {};
+  size_t pending_limit_ = DEFAULT_PENDING_LIMIT;
+  PendingPolicy pending_policy_ = PendingPolicy::DropTail;
+  PendingStats pending_stats_ {};
+  void release_waiting( NeighborTable::Neighbor& neighbor );
+  void push_ipv4_frame( const EthernetAddress& dst, const InternetDatagram& dgram );
 
 public:
   // Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer)
@@ -137,6 +110,9 @@ public:
   // Access queue of Ethernet frames awaiting transmission
   std::optional<EthernetFrame> maybe_send();
 
+  // Move every frame awaiting transmission to the end of `frames`; returns how many
+  size_t drain_frames( std::vector<EthernetFrame>& frames );
+
   // Sends an IPv4 datagram, encapsulated in an Ethernet frame (if it knows the Ethernet destination
   // address). Will need to use [ARP](\ref rfc::rfc826) to look up the Ethernet destination address
   // for the next hop.
@@ -150,6 +126,34 @@ public:
   // If type is ARP reply, learn a mapping from the "sender" fields.
   std::optional<InternetDatagram> recv_frame( const EthernetFrame& frame );
 
+  // Receives a burst of frames, as recv_frame() each, appending the IPv4 datagrams to `datagrams`; returns
+  // how many were appended
+  size_t recv_frames( std::span<const EthernetFrame> frames, std::vector<InternetDatagram>& datagrams );
+
   // Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
+
+  // Set the interface MTU (68 to EthernetHeader::MAX_MTU bytes). Larger datagrams are dropped, as
+  // minnow sends with DF and does not fragment; oversized_dropped() counts them.
+  void set_mtu( size_t mtu );
+  size_t mtu() const { return mtu_; }
+  uint64_t oversized_dropped() const { return oversized_dropped_; }
+
+  // Bound each unresolved next hop's queue of datagrams to `limit` (at least 1), handling overflow by `policy`.
+  // Datagrams still queued when the next hop's ARP request times out are dropped.
+  void set_pending_limit( size_t limit, PendingPolicy policy = PendingPolicy::DropTail );
+  const PendingStats& pending_stats() const { return pending_stats_; }
+
+  // Keep mappings in use from expiring: starting `lead_ms` before a mapping would expire, if it has been sent
+  // to since it was last confirmed, ask the neighbor again with unicast ARP (up to ARP_REFRESH_PROBES times,
+  // evenly spaced) while continuing to use it. 0 (the default) turns this off, so that mappings simply expire.
+  void set_arp_refresh( uint64_t lead_ms );
+
+  // Map `ip` to `ethernet_address` for good: the mapping never expires, and ARP does not change it
+  void add_static_neighbor( const Address& ip, const EthernetAddress& ethernet_address );
+
+  const EthernetAddress& ethernet_address() const { return ethernet_address_; }
+
+  // Neighbors the interface is keeping any state for (a mapping, or an ARP request awaiting reply)
+  size_t neighbors() const { return neighbors_.size(); }
 };
@@ -1,8 +1,13 @@
 #include "router.hh"
 
-#include <bitset>
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <numeric>
+#include <string_view>
 
 using namespace std;
 
@@ -21,22 +26,193 @@ void Router::add_route( const uint32_t route_prefix,
        << static_cast<int>( prefix_length ) << " => " << ( next_hop.has_value() ? next_hop->ip() : "(direct)" )
        << " on interface " << interface_num << "\n";
 
-  route_table.emplace_back( make_tuple( route_prefix, prefix_length, next_hop, interface_num ) );
+  auto& fib = *fib_.load();
+  fib.prefixes.insert( route_prefix, prefix_length, static_cast<PrefixTable::Value>( fib.routes.size() ) );
+  const bool direct = not next_hop.has_value();
+  fib.routes.push_back( { direct ? 0 : next_hop->ipv4_numeric(), direct, interface_num } );
+}
+
+namespace {
+
+// Parse a decimal number up to `max` from the front of `text`, consuming it
+bool parse_number( string_view& text, uint64_t max, uint64_t& value )
+{
+  const auto [end, error] = from_chars( text.data(), text.data() + text.size(), value );
+  if ( error != errc {} or value > max ) {
+    return false;
+  }
+  text.remove_prefix( end - text.data() );
+  return true;
+}
+
+// Parse a dotted-quad IPv4 address from the front of `text`, consuming it
+bool parse_ipv4( string_view& text, uint32_t& address )
+{
+  address = 0;
+  for ( int i = 0; i < 4; i++ ) {
+    if ( i > 0 ) {
+      if ( text.empty() or text.front() != '.' ) {
+        return false;
+      }
+      text.remove_prefix( 1 );
+    }
+    uint64_t byte {};
+    if ( not parse_number( text, 255, byte ) ) {
+      return false;
+    }
+    address = address << 8 | static_cast<uint32_t>( byte );
+  }
+  return true;
+}
+
+void skip_spaces( string_view& text )
+{
+  while ( not text.empty() and ( text.front() == ' ' or text.front() == '\t' or text.front() == '\r' ) ) {
+    text.remove_prefix( 1 );
+  }
+}
+
+// Stable counting sort of `items` by `key( item )`, a number below `keys`
+template<typename T, typename Key>
+vector<T> counting_sort( const vector<T>& items, const size_t keys, Key key )
+{
+  vector<size_t> starts( keys + 1 );
+  for ( const auto& item : items ) {
+    starts[key( item ) + 1]++;
+  }
+  partial_sum( starts.begin(), starts.end(), starts.begin() );
+  vector<T> sorted( items.size() );
+  for ( const auto& item : items ) {
+    sorted[starts[key( item )]++] = item;
+  }
+  return sorted;
+}
+
+} // namespace
+
+size_t Router::load_routes( const string& path )
+{
+  const auto start = chrono::steady_clock::now();
+
+  ifstream file { path, ios::binary };
+  if ( not file ) {
+    throw runtime_error( "Router: could not open " + path );
+  }
+  file.seekg( 0, ios::end );
+  string contents( static_cast<size_t>( file.tellg() ), '\0' );
+  file.seekg( 0 );
+  file.read( contents.data(), static_cast<streamsize>( contents.size() ) );
+  if ( not file ) {
+    throw runtime_error( "Router: could not read " + path );
+  }
+
+  struct Prefix
+  {
+    uint32_t prefix;
+    uint8_t length;
+    PrefixTable::Value route;
+  };
+  vector<Prefix> prefixes;
+  auto fib = make_shared<ForwardingTable>();
+
+  string_view rest = contents;
+  for ( size_t line_number = 1; not rest.empty(); line_number++ ) {
+    const size_t newline = rest.find( '\n' );
+    string_view line = rest.substr( 0, newline );
+    rest.remove_prefix( newline == string_view::npos ? rest.size() : newline + 1 );
+    line = line.substr( 0, line.find( '#' ) );
+    skip_spaces( line );
+    if ( line.empty() ) {
+      continue;
+    }
+
+    uint32_t prefix {};
+    uint64_t length {};
+    uint32_t next_hop {};
+    uint64_t interface_num {};
+    bool ok = parse_ipv4( line, prefix ) and not line.empty() and line.front() == '/';
+    if ( ok ) {
+      line.remove_prefix( 1 );
+      ok = parse_number( line, 32, length );
+    }
+    skip_spaces( line );
+    const bool direct = ok and not line.empty() and line.front() == '-';
+    if ( direct ) {
+      line.remove_prefix( 1 );
+    } else {
+      ok = ok and parse_ipv4( line, next_hop );
+    }
+    skip_spaces( line );
+    ok = ok and parse_number( line, numeric_limits<size_t>::max(), interface_num );
+    skip_spaces( line );
+    if ( not ok or not line.empty() ) {
+      throw runtime_error( "Router: " + path + ":" + to_string( line_number ) + ": malformed route" );
+    }
+    if ( interface_num >= interfaces_.size() ) {
+      throw runtime_error( "Router: " + path + ":" + to_string( line_number ) + ": no interface "
+                           + to_string( interface_num ) );
+    }
+
+    // Without its host bits, so that equal prefixes sort together
+    prefix &= length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+    prefixes.push_back(
+      { prefix, static_cast<uint8_t>( length ), static_cast<PrefixTable::Value>( fib->routes.size() ) } );
+    fib->routes.push_back( { next_hop, direct, static_cast<size_t>( interface_num ) } );
+  }
+  if ( fib->routes.size() > PrefixTable::MAX_VALUE ) {
+    throw runtime_error( "Router: too many routes in " + path );
+  }
+
+  // Most specific first: each slot is then written once, by the longest prefix covering it, and shorter
+  // prefixes only fill the gaps. Within a length, prefixes go in address order, so that the chunks they
+  // make are laid out (and later filled) in order. Both sorts are stable, so of equal prefixes the first in
+  // the file wins.
+  prefixes = counting_sort( prefixes, 1 << 16, []( const Prefix& p ) { return p.prefix >> 16; } );
+  prefixes = counting_sort( prefixes, 33, []( const Prefix& p ) { return 32 - p.length; } );
+
+  // Room for every chunk the prefixes make, so that the table is built in place
+  vector<bool> level1( 1 << 16 );
+  vector<bool> level2( 1 << 24 );
+  size_t chunks = 0;
+  for ( const auto& p : prefixes ) {
+    if ( p.length > 16 and not level1[p.prefix >> 16] ) {
+      level1[p.prefix >> 16] = true;
+      chunks++;
+    }
+    if ( p.length > 24 and not level2[p.prefix >> 8] ) {
+      level2[p.prefix >> 8] = true;
+      chunks++;
+    }
+  }
+  fib->prefixes.reserve( chunks );
+
+  for ( const auto& p : prefixes ) {
+    fib->prefixes.insert( p.prefix, p.length, p.route );
+  }
+
+  const size_t count = fib->routes.size();
+  fib_.store( move( fib ) );
+
+  const auto elapsed = chrono::duration_cast<chrono::milliseconds>( chrono::steady_clock::now() - start );
+  cerr << "DEBUG: loaded " << count << " routes from " << path << " in " << elapsed.count() << " ms\n";
+  return count;
 }
 
 void Router::route()
 {
+  const auto fib = fib_.load();
   do {
     for ( auto& interface_ : interfaces_ ) {
-      for ( auto opt = interface_.maybe_receive(); opt.has_value(); opt = interface_.maybe_receive() ) {
-        auto& dgram = opt.value();
+      burst_.clear();
+      interface_.maybe_receive( burst_ );
+      for ( auto& dgram : burst_ ) {
         auto& header = dgram.header;
         if ( header.ttl == 0 || --header.ttl == 0 )
           continue;
         header.compute_checksum();
 
         auto ip = header.dst;
-        auto rtentry = match_rt_entry( ip );
+        auto rtentry = lookup( *fib, ip );
         // no match route
         if ( not rtentry.has_value() )
           continue;
@@ -48,28 +224,18 @@ void Router::route()
   } while ( false );
 }
 
-// originally designed to return entry, now return
+// The next hop and interface for a datagram to `ip`, by the longest matching prefix (the first added of equals)
 optional<pair<Address, size_t>> Router::match_rt_entry( const uint32_t ip )
 {
-  constexpr auto getMask = []( const uint32_t _ip, const uint8_t mask ) {
-    uint64_t bits = numeric_limits<uint32_t>::max() * 1ULL << ( 32 - mask );
-    return _ip & bits;
-  };
-
-  int maxLen = -1;
-  const optional<Address>* p1 = nullptr;
-  const size_t* p2 = nullptr;
-  for ( const auto& [pref, mask, nhop, num] : route_table ) {
-    if ( getMask( ip, mask ) != getMask( pref, mask ) )
-      continue;
-    if ( maxLen < mask ) {
-      maxLen = mask;
-      p1 = &nhop;
-      p2 = &num;
-    }
-  }
+  return lookup( *fib_.load(), ip );
+}
 
-  if ( !p1 )
+optional<pair<Address, size_t>> Router::lookup( const ForwardingTable& fib, const uint32_t ip )
+{
+  const auto index = fib.prefixes.find( ip );
+  if ( index == PrefixTable::NONE ) {
     return nullopt;
-  return make_pair( p1->value_or( Address::from_ipv4_numeric( ip ) ), *p2 );
-}
\ No newline at end of file
+  }
+  const auto& route = fib.routes[index];
+  return make_pair( Address::from_ipv4_numeric( route.direct ? ip : route.next_hop ), route.interface_num );
+}
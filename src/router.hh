@@ -1,9 +1,15 @@
 #pragma once
 
 #include "network_interface.hh"
+#include "prefix_table.hh"
 
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <optional>
-#include <queue>
+#include <span>
+#include <string>
+#include <vector>
 
 // A wrapper for NetworkInterface that makes the host-side
 // interface asynchronous: instead of returning received datagrams
@@ -12,7 +18,7 @@
 // implementation of NetworkInterface.
 class AsyncNetworkInterface : public NetworkInterface
 {
-  std::queue<InternetDatagram> datagrams_in_ {};
+  std::deque<InternetDatagram> datagrams_in_ {};
 
 public:
   using NetworkInterface::NetworkInterface;
@@ -31,10 +37,18 @@ public:
   {
     auto optional_dgram = NetworkInterface::recv_frame( frame );
     if ( optional_dgram.has_value() ) {
-      datagrams_in_.push( std::move( optional_dgram.value() ) );
+      datagrams_in_.push_back( std::move( optional_dgram.value() ) );
     }
   };
 
+  // Receives a burst of frames, as recv_frame() each
+  void recv_frames( std::span<const EthernetFrame> frames )
+  {
+    for ( const auto& frame : frames ) {
+      recv_frame( frame );
+    }
+  }
+
   // Access queue of Internet datagrams that have been received
   std::optional<InternetDatagram> maybe_receive()
   {
@@ -43,9 +57,20 @@ public:
     }
 
     InternetDatagram datagram = std::move( datagrams_in_.front() );
-    datagrams_in_.pop();
+    datagrams_in_.pop_front();
     return datagram;
   }
+
+  // Move every received datagram to the end of `datagrams`; returns how many
+  size_t maybe_receive( std::vector<InternetDatagram>& datagrams )
+  {
+    const size_t count = datagrams_in_.size();
+    datagrams.insert( datagrams.end(),
+                      std::make_move_iterator( datagrams_in_.begin() ),
+                      std::make_move_iterator( datagrams_in_.end() ) );
+    datagrams_in_.clear();
+    return count;
+  }
 };
 
 // A router that has multiple network interfaces and
@@ -54,9 +79,26 @@ class Router
 {
   // The router's collection of network interfaces
   std::vector<AsyncNetworkInterface> interfaces_ {};
+  std::vector<InternetDatagram> burst_ {}; // datagrams being routed, kept to reuse its storage
 
   using _prefix_mask_t = std::pair<uint32_t, uint8_t>;
-  std::vector<std::tuple<uint32_t, uint8_t, std::optional<Address>, std::size_t>> route_table {};
+  // The forwarding table: the next hop and interface of each route, and the longest-prefix-match table from
+  // destinations to the index of their route
+  struct ForwardingTable
+  {
+    struct Route
+    {
+      uint32_t next_hop; // if not direct
+      bool direct;       // the network is attached, so the next hop is the destination itself
+      size_t interface_num;
+    };
+    std::vector<Route> routes {};
+    PrefixTable prefixes {};
+  };
+  // Replaced whole by load_routes(), so that route() can go on forwarding while a new table is built
+  std::atomic<std::shared_ptr<ForwardingTable>> fib_ { std::make_shared<ForwardingTable>() };
+
+  static std::optional<std::pair<Address, std::size_t>> lookup( const ForwardingTable& fib, uint32_t ip );
 
 public:
   // Add an interface to the router
@@ -77,6 +119,14 @@ public:
                   std::optional<Address> next_hop,
                   size_t interface_num );
 
+  // Replace the routes with those in a route dump file, one per line (blank lines and #-comments aside):
+  //    PREFIX/LENGTH NEXT_HOP INTERFACE
+  // where NEXT_HOP is an IPv4 address, or "-" for a directly attached network. The new table is built to the
+  // side without logging each route, then swapped in whole (so this may run while another thread routes).
+  // Throws (keeping the old routes) if the file cannot be read, a line is malformed, or a route names an
+  // interface the router does not have. Returns the route count.
+  size_t load_routes( const std::string& path );
+
   // Route packets between the interfaces. For each interface, use the
   // maybe_receive() method to consume every incoming datagram and
   // send it on one of interfaces to the correct next hop. The router
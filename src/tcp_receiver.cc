@@ -30,8 +30,32 @@ void TCPReceiver::receive( TCPSenderMessage message, Reassembler& reassembler, W
 TCPReceiverMessage TCPReceiver::send( const Writer& inbound_stream ) const
 {
   TCPReceiverMessage msg;
-  msg.window_size = static_cast<uint16_t>( min( UINT16_MAX * 1UL, inbound_stream.available_capacity() ) );
+  // Round down to what the scaled 16-bit window field can express exactly
+  const uint64_t max_window = uint64_t { UINT16_MAX } << window_shift_;
+  const uint64_t window = min( max_window, inbound_stream.available_capacity() );
+  msg.window_size = static_cast<uint32_t>( window >> window_shift_ << window_shift_ );
   if ( connected )
     msg.ackno = their_seqno;
   return msg;
 }
+
+bool TCPReceiver::check_timestamp( const TCPSenderMessage& message,
+                                   const uint32_t tsval,
+                                   const optional<Wrap32> last_ack_sent )
+{
+  // Timestamps compare modulo 2^32, like sequence numbers
+  if ( ts_recent_.has_value() && static_cast<int32_t>( tsval - ts_recent_.value() ) < 0 && !message.SYN )
+    return false;
+
+  // Only a segment that starts at or before Last.ACK.sent may move TS.Recent. Comparing against the
+  // current ackno instead would let the second segment covered by a delayed ACK replace the first one's
+  // TSval, and the peer's RTT samples would leave out the delay.
+  bool at_or_before_last_ack = false;
+  if ( last_ack_sent.has_value() ) {
+    const auto offset = static_cast<uint32_t>( message.seqno.unwrap( last_ack_sent.value(), 0 ) );
+    at_or_before_last_ack = static_cast<int32_t>( offset ) <= 0;
+  }
+  if ( message.SYN || at_or_before_last_ack )
+    ts_recent_ = tsval;
+  return true;
+}
@@ -13,6 +13,12 @@ class TCPReceiver
   Wrap32 their_seqno { 0 }, their_zero { 0 };
   // uint64_t their_absseq = 0, my_absseq = 0;
 
+  // RFC 7323: most recent in-window TSval from the peer, echoed back as TSecr
+  std::optional<uint32_t> ts_recent_ {};
+
+  // RFC 7323 window scale we advertise with; 0 limits the window to UINT16_MAX
+  uint8_t window_shift_ = 0;
+
 public:
   /*
    * The TCPReceiver receives TCPSenderMessages, inserting their payload into the Reassembler
@@ -22,4 +28,18 @@ public:
 
   /* The TCPReceiver sends TCPReceiverMessages back to the TCPSender. */
   TCPReceiverMessage send( const Writer& inbound_stream ) const;
+
+  /* Use a negotiated window scale: windows may grow to UINT16_MAX << shift, in multiples of 1 << shift */
+  void set_window_scale( uint8_t shift ) { window_shift_ = shift; }
+  uint8_t window_scale() const { return window_shift_; }
+
+  /*
+   * PAWS (RFC 7323): check the TSval of an arriving segment before receive(). Returns false if the
+   * segment is an old duplicate that must be dropped (and acknowledged); otherwise updates TS.Recent
+   * when the segment starts at or before `last_ack_sent`, the ackno of the last ACK actually sent.
+   */
+  bool check_timestamp( const TCPSenderMessage& message, uint32_t tsval, std::optional<Wrap32> last_ack_sent );
+
+  /* The value to echo in TSecr, once a timestamp has been accepted */
+  std::optional<uint32_t> ts_recent() const { return ts_recent_; }
 };
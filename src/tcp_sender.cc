@@ -11,6 +11,7 @@ TCPSender::TCPSender( uint64_t initial_RTO_ms, optional<Wrap32> fixed_isn )
   : isn_( fixed_isn.value_or( Wrap32 { random_device()() } ) )
   , initial_RTO_ms_( initial_RTO_ms )
   , RTO( initial_RTO_ms )
+  , rto_base_( initial_RTO_ms )
 {}
 
 uint64_t TCPSender::sequence_numbers_in_flight() const
@@ -30,30 +31,83 @@ optional<TCPSenderMessage> TCPSender::maybe_send()
   if ( sent_RT < cnt_RT ) {
     timer.start = true;
     sent_RT++;
-    return unacks[0];
+    return transmit( unacks[0], true );
+  }
+  for ( size_t i = 0; retx_pending_count_ && i < s_isend; i++ ) {
+    if ( unacks[i].retx_pending ) {
+      timer.start = true;
+      return transmit( unacks[i], true );
+    }
   }
   if ( s_isend < unacks.size() ) {
     timer.start = true;
-    return unacks[s_isend++];
+    return transmit( unacks[s_isend++], false );
   }
 
   return nullopt;
 }
 
+size_t TCPSender::maybe_send( vector<TCPSenderMessage>& out, const size_t max_count )
+{
+  size_t count = 0;
+  while ( count < max_count && sent_RT < cnt_RT ) {
+    timer.start = true;
+    sent_RT++;
+    out.push_back( transmit( unacks[0], true ) );
+    count++;
+  }
+  for ( size_t i = 0; count < max_count && retx_pending_count_ && i < s_isend; i++ ) {
+    if ( unacks[i].retx_pending ) {
+      timer.start = true;
+      out.push_back( transmit( unacks[i], true ) );
+      count++;
+    }
+  }
+  while ( count < max_count && s_isend < unacks.size() ) {
+    timer.start = true;
+    out.push_back( transmit( unacks[s_isend++], false ) );
+    count++;
+  }
+  return count;
+}
+
+// Stamp an outstanding segment as sent now; new segments are counted in s_isend by the caller
+const TCPSenderMessage& TCPSender::transmit( Outstanding& seg, const bool retransmission )
+{
+  seg.sent_ms = now_ms_;
+  if ( retransmission ) {
+    seg.retransmitted = true;
+    segments_retransmitted_++;
+    bytes_retransmitted_ += seg.msg.payload.size();
+    if ( seg.retx_pending ) {
+      seg.retx_pending = false;
+      retx_pending_count_--;
+    }
+  } else {
+    arm_tlp();
+  }
+  return seg.msg;
+}
+
 void TCPSender::push( Reader& outbound_stream )
 {
   if ( outbound_stream.is_finished() && s_seqno == outbound_stream.bytes_popped() + 1 )
     force_send = true;
   // Loop to send as much as possible
   while ( ( outbound_stream.bytes_buffered() || force_send )
-          && ( ( !window_size && !zero_window_handling ) || s_seqno - s_seqack < window_size ) ) {
+          && ( ( !window_size && !zero_window_handling ) || s_seqno - s_seqack < send_window() ) ) {
     TCPSenderMessage msg;
     force_send = false;
 
     msg.SYN = s_seqno == 0;
     msg.seqno = isn_ + s_seqno;
 
-    auto max_payload = min( MAX_PAYLOAD_SIZE, window_size - ( s_seqno - s_seqack ) );
+    auto max_payload = min( max_payload_, send_window() - ( s_seqno - s_seqack ) );
+
+    // a Fast Open SYN carries data the peer's window has not offered yet
+    if ( msg.SYN && syn_payload_ > 0 ) {
+      max_payload = syn_payload_;
+    }
 
     // special case for window = 0
     if ( window_size == 0 ) {
@@ -67,15 +121,15 @@ void TCPSender::push( Reader& outbound_stream )
     outbound_stream.pop( len );
 
     if ( outbound_stream.is_finished() ) {
-      if ( msg.sequence_length() < window_size - ( s_seqno - s_seqack ) + zero_window_handling ) {
+      if ( msg.sequence_length() < send_window() - ( s_seqno - s_seqack ) + zero_window_handling ) {
         msg.FIN = 1;
       } else
         force_send = true;
     }
 
     // TODO: check if msg is clear after move.
-    unacks.emplace_back( msg );
     s_seqno += msg.sequence_length();
+    unacks.push_back( { .msg = move( msg ), .end = s_seqno } );
   }
 }
 
@@ -99,16 +153,23 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
   if ( msg_seqno > s_seqno )
     return;
 
+  const auto acked_before = s_seqack;
+  const auto flight_before = s_seqno - s_seqack;
   while ( s_seqack < s_seqno ) {
-    auto check_msg = unacks.front();
+    const auto& check_msg = unacks.front().msg;
     auto check_seqno = check_msg.seqno.unwrap( isn_, s_seqack );
 
     if ( check_seqno + check_msg.sequence_length() <= msg_seqno ) {
+      if ( !unacks.front().sacked )
+        rack_update( unacks.front() );
+      if ( unacks.front().retx_pending )
+        retx_pending_count_--;
+
       s_seqack += check_msg.sequence_length();
       s_isend--;
       unacks.pop_front();
 
-      RTO = initial_RTO_ms_;
+      RTO = rto_base_;
       cnt_RT = sent_RT = 0;
       timer.ms_elapsed = 0; // TODO: maybe half accept should clear this.
 
@@ -117,12 +178,229 @@ void TCPSender::receive( const TCPReceiverMessage& msg )
       break;
   }
 
+  // The peer acknowledged our SYN but not the Fast Open data it carried: send the data again at once
+  if ( s_seqack == 0 && msg_seqno == 1 && !unacks.empty() && unacks.front().msg.SYN ) {
+    auto& front = unacks.front();
+    front.msg.SYN = false;
+    front.msg.seqno = isn_ + 1;
+    s_seqack = 1;
+    mark_retx( front );
+    RTO = rto_base_;
+    cnt_RT = sent_RT = 0;
+    timer.ms_elapsed = 0;
+  }
+
   if ( s_seqack == s_seqno )
     timer.reset();
+
+  // (the SYN's sequence number does not open the window)
+  cwnd_on_ack( s_seqack - acked_before - ( acked_before == 0 && s_seqack > 0 ), flight_before );
+
+  if ( rack_tlp_ ) {
+    rack_detect_loss();
+    if ( s_seqack > acked_before ) {
+      tlp_outstanding_ = false;
+      arm_tlp();
+    }
+  }
+}
+
+void TCPSender::enable_congestion_control( const bool dctcp )
+{
+  cwnd_ = 10 * max_payload_; // RFC 6928 initial window
+  dctcp_ = dctcp;
+}
+
+void TCPSender::cwnd_on_ack( const uint64_t acked_bytes, const uint64_t flight_before )
+{
+  // Only grow a window that is actually in use (RFC 7661), not one held back by the receiver or the app
+  if ( !cwnd_.has_value() || acked_bytes == 0 || s_seqack < recovery_end_
+       || flight_before + max_payload_ < cwnd_.value() )
+    return;
+
+  if ( cwnd_.value() < ssthresh_ ) {
+    *cwnd_ += acked_bytes; // slow start, counting every byte even when ACKs arrive compressed or delayed
+  } else {
+    ca_acked_ += acked_bytes; // congestion avoidance: one segment per window acknowledged
+    if ( ca_acked_ >= cwnd_.value() ) {
+      ca_acked_ -= cwnd_.value();
+      *cwnd_ += max_payload_;
+    }
+  }
+}
+
+// Halve the window once per loss episode; after a timeout, restart from one segment
+void TCPSender::cwnd_on_loss( const bool timeout )
+{
+  if ( !cwnd_.has_value() || ( !timeout && s_seqack < recovery_end_ ) )
+    return;
+
+  recovery_end_ = s_seqno;
+  ssthresh_ = max<uint64_t>( ( s_seqno - s_seqack ) / 2, 2 * max_payload_ );
+  cwnd_ = timeout ? max_payload_ : ssthresh_;
+  ca_acked_ = 0;
+}
+
+bool TCPSender::ecn_echo( const bool ece, const uint64_t acked_bytes )
+{
+  if ( !cwnd_.has_value() )
+    return false;
+
+  // DCTCP: once per window of data, fold the fraction of marked bytes into alpha (gain 1/16)
+  if ( dctcp_ ) {
+    dctcp_acked_ += acked_bytes;
+    dctcp_marked_ += ece ? acked_bytes : 0;
+    if ( s_seqack >= dctcp_window_end_ && dctcp_acked_ > 0 ) {
+      const uint64_t fraction = dctcp_marked_ * DCTCP_ALPHA_ONE / dctcp_acked_;
+      dctcp_alpha_ = dctcp_alpha_ - dctcp_alpha_ / 16 + fraction / 16;
+      dctcp_acked_ = dctcp_marked_ = 0;
+      dctcp_window_end_ = s_seqno;
+    }
+  }
+
+  // React at most once per window of data
+  if ( !ece || s_seqack < cwr_end_ )
+    return false;
+
+  cwr_end_ = s_seqno;
+  const uint64_t cwnd = cwnd_.value();
+  const uint64_t reduced = dctcp_ ? cwnd - cwnd * dctcp_alpha_ / ( 2 * DCTCP_ALPHA_ONE ) : cwnd / 2;
+  ssthresh_ = max<uint64_t>( reduced, 2 * max_payload_ );
+  cwnd_ = ssthresh_;
+  ca_acked_ = 0;
+  return true;
+}
+
+void TCPSender::receive_sack( const Wrap32 left, const Wrap32 right )
+{
+  const auto l = left.unwrap( isn_, s_seqack );
+  const auto r = right.unwrap( isn_, s_seqack );
+  if ( r <= l || l < s_seqack || r > s_seqno )
+    return;
+
+  for ( size_t i = 0; i < s_isend; i++ ) {
+    auto& seg = unacks[i];
+    const auto begin = seg.end - seg.msg.sequence_length();
+    if ( begin >= r )
+      break;
+    if ( seg.sacked || begin < l || seg.end > r )
+      continue;
+
+    seg.sacked = true;
+    if ( seg.retx_pending ) {
+      seg.retx_pending = false;
+      retx_pending_count_--;
+    }
+    rack_update( seg );
+  }
+}
+
+// RFC 8985 step 2: remember the most recently sent segment that has been delivered
+void TCPSender::rack_update( const Outstanding& seg )
+{
+  const uint64_t rtt = now_ms_ - seg.sent_ms;
+
+  // The ACK of a retransmission may be for the original: ignore it if it came back implausibly fast
+  if ( seg.retransmitted && ( !min_rtt_ms_.has_value() || rtt < min_rtt_ms_.value() ) )
+    return;
+
+  min_rtt_ms_ = min( min_rtt_ms_.value_or( rtt ), rtt );
+  if ( !rack_.valid || seg.sent_ms > rack_.xmit_ms || ( seg.sent_ms == rack_.xmit_ms && seg.end > rack_.end ) )
+    rack_ = { .xmit_ms = seg.sent_ms, .end = seg.end, .rtt_ms = rtt, .valid = true };
+}
+
+// RFC 8985 step 5: anything sent before the RACK segment and still undelivered a reordering window
+// after it should have been delivered is lost; otherwise check again once that time has come.
+void TCPSender::rack_detect_loss()
+{
+  rack_deadline_ms_.reset();
+  if ( !rack_.valid )
+    return;
+
+  const uint64_t reo_wnd = min_rtt_ms_.value_or( 0 ) / 4;
+  for ( size_t i = 0; i < s_isend; i++ ) {
+    auto& seg = unacks[i];
+    const bool sent_before
+      = seg.sent_ms < rack_.xmit_ms || ( seg.sent_ms == rack_.xmit_ms && seg.end < rack_.end );
+    if ( seg.sacked || seg.retx_pending || !sent_before )
+      continue;
+
+    const uint64_t deadline = seg.sent_ms + rack_.rtt_ms + reo_wnd;
+    if ( deadline <= now_ms_ ) {
+      mark_retx( seg );
+      cwnd_on_loss( false );
+    } else
+      rack_deadline_ms_ = min( rack_deadline_ms_.value_or( deadline ), deadline );
+  }
+}
+
+// RFC 8985 section 7.2: probe after 2 SRTT (plus a delayed-ACK allowance for a lone segment),
+// unless the RTO would fire first anyway
+void TCPSender::arm_tlp()
+{
+  tlp_deadline_ms_.reset();
+  if ( !rack_tlp_ || !srtt_ms_.has_value() || tlp_outstanding_ || s_isend == 0 )
+    return;
+
+  uint64_t pto = max<uint64_t>( 2 * srtt_ms_.value(), 1 );
+  if ( s_isend == 1 )
+    pto += TCPConfig::MAX_DELAYED_ACK_MS;
+
+  const uint64_t rto_left = RTO > timer.ms_elapsed ? RTO - timer.ms_elapsed : 0;
+  if ( pto < rto_left )
+    tlp_deadline_ms_ = now_ms_ + pto;
+}
+
+void TCPSender::mark_retx( Outstanding& seg )
+{
+  if ( !seg.retx_pending ) {
+    seg.retx_pending = true;
+    retx_pending_count_++;
+  }
+}
+
+void TCPSender::rtt_sample( const uint64_t rtt_ms )
+{
+  min_rtt_ms_ = min( min_rtt_ms_.value_or( rtt_ms ), rtt_ms );
+
+  if ( !srtt_ms_.has_value() ) {
+    srtt_ms_ = rtt_ms;
+    rttvar_ms_ = rtt_ms / 2;
+  } else {
+    const uint64_t srtt = srtt_ms_.value();
+    const uint64_t err = srtt > rtt_ms ? srtt - rtt_ms : rtt_ms - srtt;
+    rttvar_ms_ = ( 3 * rttvar_ms_ + err ) / 4;
+    srtt_ms_ = ( 7 * srtt + rtt_ms ) / 8;
+  }
+
+  // Never go below the configured initial RTO if that is already smaller than the usual floor
+  const uint64_t rto_min = min( initial_RTO_ms_, TCPConfig::RTO_MIN_MS );
+  rto_base_ = clamp( srtt_ms_.value() + max<uint64_t>( 1, 4 * rttvar_ms_ ), rto_min, TCPConfig::RTO_MAX_MS );
+
+  // Keep any exponential backoff in place until new data is acknowledged
+  if ( cnt_RT == 0 )
+    RTO = rto_base_;
 }
 
 void TCPSender::tick( const size_t ms_since_last_tick )
 {
+  now_ms_ += ms_since_last_tick;
+
+  if ( rack_deadline_ms_.has_value() && now_ms_ >= rack_deadline_ms_.value() )
+    rack_detect_loss();
+
+  // Tail loss probe: resend the last segment not known to be delivered
+  if ( tlp_deadline_ms_.has_value() && now_ms_ >= tlp_deadline_ms_.value() ) {
+    tlp_deadline_ms_.reset();
+    for ( size_t i = s_isend; i > 0; i-- ) {
+      if ( !unacks[i - 1].sacked ) {
+        tlp_outstanding_ = true;
+        mark_retx( unacks[i - 1] );
+        break;
+      }
+    }
+  }
+
   if ( !timer.start )
     return;
 
@@ -131,5 +409,24 @@ void TCPSender::tick( const size_t ms_since_last_tick )
     timer.reset();
     cnt_RT++;
     RTO <<= !zero_window_handling;
+    tlp_deadline_ms_.reset();
+    cwnd_on_loss( true );
   }
 }
+
+optional<uint64_t> TCPSender::retransmission_timer_ms() const
+{
+  if ( !timer.start )
+    return nullopt;
+  return RTO > timer.ms_elapsed ? RTO - timer.ms_elapsed : 0;
+}
+
+optional<uint64_t> TCPSender::loss_detection_timer_ms() const
+{
+  optional<uint64_t> deadline = rack_deadline_ms_;
+  if ( tlp_deadline_ms_.has_value() )
+    deadline = min( deadline.value_or( UINT64_MAX ), tlp_deadline_ms_.value() );
+  if ( !deadline.has_value() )
+    return nullopt;
+  return deadline.value() > now_ms_ ? deadline.value() - now_ms_ : 0;
+}
@@ -4,7 +4,9 @@
 #include "tcp_config.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
+#include <algorithm>
 #include <deque>
+#include <vector>
 
 class TCPSender
 {
@@ -13,15 +15,33 @@ class TCPSender
   uint64_t initial_RTO_ms_;
   uint64_t RTO = 0;
 
+  // Largest payload of a new segment: the effective MSS once negotiated
+  size_t max_payload_ = MAX_PAYLOAD_SIZE;
+
   // bytes available
   uint64_t window_size = 1;
-  std::deque<TCPSenderMessage> unacks = {};
+
+  // TCP Fast Open (RFC 7413): payload the SYN may carry beyond the initial window (0: a bare SYN)
+  size_t syn_payload_ = 0;
+
+  struct Outstanding
+  {
+    TCPSenderMessage msg;
+    uint64_t end = 0;          // absolute seqno just past the segment
+    uint64_t sent_ms = 0;      // when last (re)transmitted
+    bool sacked = false;       // delivered out of order, according to a SACK block
+    bool retx_pending = false; // marked lost by RACK, or chosen as a tail loss probe
+    bool retransmitted = false;
+  };
+  std::deque<Outstanding> unacks = {};
   uint64_t s_seqno = 0;
   uint64_t s_seqack = 0;
   uint32_t s_isend = 0;
 
   uint32_t cnt_RT = 0;
   uint32_t sent_RT = 0;
+  uint64_t segments_retransmitted_ = 0;
+  uint64_t bytes_retransmitted_ = 0;
   bool force_send = true;
   bool zero_window_handling = false;
 
@@ -33,6 +53,55 @@ class TCPSender
   };
   VanillaTimer timer = {};
 
+  // RFC 6298 round-trip estimation; RTO is reset to rto_base_ when new data is acknowledged
+  std::optional<uint64_t> srtt_ms_ {};
+  uint64_t rttvar_ms_ = 0;
+  uint64_t rto_base_;
+
+  // Milliseconds since construction; sent times of outstanding segments are measured on this clock
+  uint64_t now_ms_ = 0;
+
+  // RACK-TLP (RFC 8985): a segment is lost once one sent after it has been delivered and a reordering
+  // window has passed; a tail loss probe resends the last segment when ACKs stop arriving after ~2 SRTT.
+  bool rack_tlp_ = false;
+  struct RackState
+  {
+    uint64_t xmit_ms = 0; // send time of the most recently sent segment known delivered
+    uint64_t end = 0;     // and its end, to order segments sent in the same millisecond
+    uint64_t rtt_ms = 0;  // RTT measured on that segment
+    bool valid = false;
+  };
+  RackState rack_ = {};
+  std::optional<uint64_t> min_rtt_ms_ {};
+  std::optional<uint64_t> rack_deadline_ms_ {}; // reordering timer: re-run loss detection then
+  std::optional<uint64_t> tlp_deadline_ms_ {};
+  bool tlp_outstanding_ = false; // one probe per tail; cleared when new data is acknowledged
+  size_t retx_pending_count_ = 0;
+
+  // Congestion control (RFC 5681), off unless enabled: then the send window is min(receiver window, cwnd).
+  // ECN marks halve cwnd (RFC 3168) or, with DCTCP (RFC 8257), cut it in proportion to the marked fraction.
+  std::optional<uint64_t> cwnd_ {};
+  uint64_t ssthresh_ = UINT64_MAX;
+  uint64_t ca_acked_ = 0;     // bytes acknowledged towards the next congestion-avoidance increase
+  uint64_t recovery_end_ = 0; // no further loss reduction until this seqno is acknowledged
+  uint64_t cwr_end_ = 0;      // likewise for ECN reductions
+  bool dctcp_ = false;
+  static constexpr uint64_t DCTCP_ALPHA_ONE = 1024; // fixed-point 1.0
+  uint64_t dctcp_alpha_ = DCTCP_ALPHA_ONE;
+  uint64_t dctcp_window_end_ = 0;
+  uint64_t dctcp_acked_ = 0;
+  uint64_t dctcp_marked_ = 0;
+
+  uint64_t send_window() const { return cwnd_.has_value() ? std::min( window_size, cwnd_.value() ) : window_size; }
+  void cwnd_on_ack( uint64_t acked_bytes, uint64_t flight_before );
+  void cwnd_on_loss( bool timeout );
+
+  void rack_update( const Outstanding& seg );
+  void rack_detect_loss();
+  void arm_tlp();
+  void mark_retx( Outstanding& seg );
+  const TCPSenderMessage& transmit( Outstanding& seg, bool retransmission );
+
 public:
   /* Construct TCP sender with given default Retransmission Timeout and possible ISN */
   TCPSender( uint64_t initial_RTO_ms, std::optional<Wrap32> fixed_isn );
@@ -43,6 +112,9 @@ public:
   /* Send a TCPSenderMessage if needed (or empty optional otherwise) */
   std::optional<TCPSenderMessage> maybe_send();
 
+  /* Append up to `max_count` TCPSenderMessages that are ready to go to `out`; returns how many were added */
+  size_t maybe_send( std::vector<TCPSenderMessage>& out, size_t max_count );
+
   /* Generate an empty TCPSenderMessage */
   TCPSenderMessage send_empty_message() const;
 
@@ -52,7 +124,47 @@ public:
   /* Time has passed by the given # of milliseconds since the last time the tick() method was called. */
   void tick( uint64_t ms_since_last_tick );
 
+  /*
+   * Milliseconds until tick() would fire the retransmission timer (which also paces zero-window probes),
+   * or the RACK reordering and tail loss probe timers; empty while the timer is not running
+   */
+  std::optional<uint64_t> retransmission_timer_ms() const;
+  std::optional<uint64_t> loss_detection_timer_ms() const;
+  bool probing_zero_window() const { return zero_window_handling; }
+
+  /* Size future segments for the effective MSS (the negotiated MSS less per-segment option bytes) */
+  void set_max_payload_size( size_t max_payload ) { max_payload_ = std::max<size_t>( max_payload, 1 ); }
+  size_t max_payload_size() const { return max_payload_; }
+
+  /* Let the SYN carry up to `max_payload` bytes of data (TCP Fast Open); call before the first push() */
+  void set_syn_payload_limit( size_t max_payload ) { syn_payload_ = max_payload; }
+
+  /* Enable RACK-TLP loss detection (needs RTT samples for the probe timeout; SACKs make RACK effective) */
+  void set_rack_tlp( bool enabled ) { rack_tlp_ = enabled; }
+
+  /* Limit sending by a congestion window, starting at 10 segments; `dctcp` selects the DCTCP ECN response */
+  void enable_congestion_control( bool dctcp );
+
+  /*
+   * ECN feedback carried by an ACK (call after receive(), with the bytes it newly acknowledged).
+   * Returns true if the congestion window was reduced, so the next new data should carry CWR.
+   */
+  bool ecn_echo( bool ece, uint64_t acked_bytes );
+
+  /* A SACK block from the peer: [left, right) has been received out of order. Call before receive(). */
+  void receive_sack( Wrap32 left, Wrap32 right );
+
+  /* Feed one round-trip time measurement (e.g. from a timestamp echo) into the RTO estimate */
+  void rtt_sample( uint64_t rtt_ms );
+
   /* Accessors for use in testing */
   uint64_t sequence_numbers_in_flight() const;  // How many sequence numbers are outstanding?
   uint64_t consecutive_retransmissions() const; // How many consecutive *re*transmissions have happened?
+  std::optional<uint64_t> srtt_ms() const { return srtt_ms_; } // Smoothed RTT, once a sample has arrived
+  uint64_t current_RTO_ms() const { return RTO; }               // Current (possibly backed-off) RTO
+  std::optional<uint64_t> cwnd() const { return cwnd_; }        // Congestion window, if enabled
+  uint64_t window() const { return window_size; }                // Latest window the receiver advertised
+  uint64_t segments_retransmitted() const { return segments_retransmitted_; } // Retransmissions so far
+  uint64_t bytes_retransmitted() const { return bytes_retransmitted_; }       // and their payload bytes
+  double dctcp_alpha() const { return static_cast<double>( dctcp_alpha_ ) / DCTCP_ALPHA_ONE; }
 };
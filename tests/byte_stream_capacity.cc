@@ -97,6 +97,28 @@ int main()
       test.execute( BytesBuffered { 1 } );
     }
 
+    {
+      ByteStreamTestHarness test { "grow-and-shrink", 2 };
+
+      test.execute( Push { "cat" } );
+      test.execute( SetCapacity { 5 } );
+      test.execute( AvailableCapacity { 3 } );
+      test.execute( Push { "fish" } );
+      test.execute( Peek { "cafis" } );
+      test.execute( AvailableCapacity { 0 } );
+
+      test.execute( SetCapacity { 3 } );
+      test.execute( AvailableCapacity { 0 } );
+      test.execute( BytesBuffered { 5 } );
+      test.execute( Push { "x" } );
+      test.execute( BytesPushed { 5 } );
+      test.execute( Pop { 3 } );
+      test.execute( AvailableCapacity { 1 } );
+      test.execute( Push { "xy" } );
+      test.execute( Peek { "isx" } );
+      test.execute( AvailableCapacity { 0 } );
+    }
+
   } catch ( const exception& e ) {
     cerr << "Exception: " << e.what() << endl;
     return EXIT_FAILURE;
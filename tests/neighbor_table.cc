@@ -0,0 +1,110 @@
+#include "neighbor_table.hh"
+#include "random.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// Drive the table and a std::map with the same random inserts, erases, and deadline moves (over an address
+// space small enough that addresses keep coming back), checking lookups and which deadlines come up when.
+void check_against_model( default_random_engine& rd )
+{
+  NeighborTable table;
+  map<uint32_t, uint64_t> model; // address to deadline
+
+  uniform_int_distribution<uint32_t> ip { 0, 300 };
+  uniform_int_distribution<uint64_t> delay { 1, 50 };
+  uniform_int_distribution<int> op { 0, 9 };
+
+  uint64_t now = 0;
+  for ( uint32_t i = 0; i < 50000; i++ ) {
+    const uint32_t key = ip( rd );
+    const auto it = model.find( key );
+    switch ( op( rd ) ) {
+      case 0:
+      case 1:
+        if ( table.erase( key ) != ( it != model.end() ) ) {
+          throw runtime_error( "erase() disagrees with model" );
+        }
+        if ( it != model.end() ) {
+          model.erase( it );
+        }
+        break;
+      case 2:
+      case 3:
+      case 4:
+      case 5: {
+        // add the neighbor, or move its deadline (earlier or later)
+        auto& neighbor = table.emplace( key );
+        neighbor.ethernet_address.at( 0 ) = static_cast<uint8_t>( key );
+        table.set_deadline( neighbor, now + delay( rd ) );
+        model[key] = neighbor.deadline;
+        break;
+      }
+      default: {
+        now += delay( rd ) / 4;
+        vector<uint32_t> expired;
+        table.expire( now, [&]( NeighborTable::Neighbor& neighbor ) {
+          if ( model.at( neighbor.ip ) != neighbor.deadline or neighbor.deadline > now ) {
+            throw runtime_error( "expire() visited a neighbor whose deadline has not passed" );
+          }
+          expired.push_back( neighbor.ip );
+          table.erase( neighbor.ip );
+        } );
+        for ( const auto e : expired ) {
+          model.erase( e );
+        }
+        for ( const auto& [addr, deadline] : model ) {
+          if ( deadline <= now ) {
+            throw runtime_error( "expire() missed a neighbor whose deadline has passed" );
+          }
+        }
+        break;
+      }
+    }
+
+    if ( table.size() != model.size() ) {
+      throw runtime_error( "size() disagrees with model" );
+    }
+    const auto* found = table.find( key );
+    if ( ( found != nullptr ) != model.contains( key )
+         or ( found != nullptr and found->ethernet_address.at( 0 ) != static_cast<uint8_t>( key ) ) ) {
+      throw runtime_error( "find() disagrees with model" );
+    }
+  }
+}
+
+// A neighbor refreshed over and over keeps a single live deadline, however often it is refreshed
+void check_refresh_is_cheap()
+{
+  NeighborTable table;
+  auto& neighbor = table.emplace( 0x0a000002 );
+  neighbor.state = NeighborTable::State::Reachable;
+  for ( uint64_t now = 1; now <= 100000; now++ ) {
+    table.set_deadline( *table.find( 0x0a000002 ), now + 30000 );
+    if ( now % 1000 == 0 ) {
+      table.expire( now, []( NeighborTable::Neighbor& ) { throw runtime_error( "refreshed neighbor expired" ); } );
+    }
+  }
+  if ( table.pending_deadlines() != 1 ) {
+    throw runtime_error( "refreshes queued more than one deadline" );
+  }
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    check_against_model( rd );
+    check_refresh_is_cheap();
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
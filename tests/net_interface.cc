@@ -6,6 +6,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <random>
+#include <vector>
 
 using namespace std;
 
@@ -320,6 +321,274 @@ int main()
         serialize( make_arp( ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5" ) ) ) } );
       test.execute( ExpectNoFrame {} );
     }
+
+    // expired neighbors are forgotten, and refreshing a mapping keeps it alive
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      constexpr unsigned MAPPINGS = 20000;
+      constexpr unsigned UNANSWERED = 5000;
+
+      for ( unsigned i = 0; i < MAPPINGS; i++ ) {
+        const string ip = "10.1." + to_string( i / 256 ) + "." + to_string( i % 256 );
+        iface.recv_frame(
+          make_frame( random_private_ethernet_address(),
+                      ETHERNET_BROADCAST,
+                      EthernetHeader::TYPE_ARP,
+                      serialize( make_arp( ARPMessage::OPCODE_REPLY, {}, ip, {}, "10.0.0.1" ) ) ) );
+      }
+      for ( unsigned i = 0; i < UNANSWERED; i++ ) {
+        const string ip = "10.2." + to_string( i / 256 ) + "." + to_string( i % 256 );
+        iface.send_datagram( make_datagram( "1.2.3.4", "5.6.7.8" ), Address( ip, 0 ) );
+      }
+      while ( iface.maybe_send().has_value() ) {}
+      if ( iface.neighbors() != MAPPINGS + UNANSWERED ) {
+        throw runtime_error( "neighbors were not all tracked" );
+      }
+
+      for ( unsigned t = 0; t < 6; t++ ) {
+        iface.tick( 1000 );
+      }
+      if ( iface.neighbors() != MAPPINGS ) {
+        throw runtime_error( "unanswered ARP requests were not forgotten: " + to_string( iface.neighbors() ) );
+      }
+
+      const EthernetAddress refreshed_eth = random_private_ethernet_address();
+      const auto reply = make_arp( ARPMessage::OPCODE_REPLY, refreshed_eth, "10.1.0.0", {}, "10.0.0.1" );
+      iface.recv_frame(
+        make_frame( refreshed_eth, ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP, serialize( reply ) ) );
+      for ( unsigned t = 0; t < 25; t++ ) {
+        iface.tick( 1000 );
+      }
+      if ( iface.neighbors() != 1 ) {
+        throw runtime_error( "expired mappings were not forgotten: " + to_string( iface.neighbors() ) );
+      }
+
+      const auto datagram = make_datagram( "1.2.3.4", "5.6.7.8" );
+      iface.send_datagram( datagram, Address( "10.1.0.0", 0 ) );
+      const auto frame = iface.maybe_send();
+      if ( not frame.has_value() or frame->header.dst != refreshed_eth
+           or frame->header.type != EthernetHeader::TYPE_IPv4 ) {
+        throw runtime_error( "refreshed mapping was not kept" );
+      }
+
+      iface.tick( 6000 );
+      if ( iface.neighbors() != 0 ) {
+        throw runtime_error( "refreshed mapping did not expire" );
+      }
+    }
+
+    // datagrams awaiting ARP resolution are queued per next hop, in order and bounded
+    using PendingPolicy = NetworkInterface::PendingPolicy;
+    for ( const auto policy : { PendingPolicy::DropTail, PendingPolicy::DropOldest } ) {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.set_pending_limit( 4, policy );
+
+      vector<InternetDatagram> burst;
+      for ( unsigned i = 0; i < 6; i++ ) {
+        burst.push_back( make_datagram( "1.2.3." + to_string( i ), "5.6.7.8" ) );
+        iface.send_datagram( burst.back(), Address( "10.0.0.2", 0 ) );
+      }
+      const auto arp = iface.maybe_send();
+      if ( not arp.has_value() or arp->header.type != EthernetHeader::TYPE_ARP or iface.maybe_send().has_value() ) {
+        throw runtime_error( "expected a single ARP request for a burst" );
+      }
+
+      const auto reply = make_arp( ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.2", local_eth, "10.0.0.1" );
+      iface.recv_frame( make_frame( remote_eth, local_eth, EthernetHeader::TYPE_ARP, serialize( reply ) ) );
+      const size_t first = policy == PendingPolicy::DropTail ? 0 : 2;
+      for ( size_t i = first; i < first + 4; i++ ) {
+        const auto frame = iface.maybe_send();
+        const auto expected = make_frame( local_eth, remote_eth, EthernetHeader::TYPE_IPv4, serialize( burst[i] ) );
+        if ( not frame.has_value() or not equal( *frame, expected ) ) {
+          throw runtime_error( "queued datagrams were not flushed in order" );
+        }
+      }
+      if ( iface.maybe_send().has_value() ) {
+        throw runtime_error( "more datagrams flushed than were queued" );
+      }
+
+      // a queue whose ARP request goes unanswered is dropped
+      iface.send_datagram( make_datagram( "1.2.3.4", "5.6.7.8" ), Address( "10.0.0.3", 0 ) );
+      iface.send_datagram( make_datagram( "1.2.3.4", "5.6.7.8" ), Address( "10.0.0.3", 0 ) );
+      iface.tick( 5000 );
+      const auto& stats = iface.pending_stats();
+      const uint64_t queued = policy == PendingPolicy::DropTail ? 6 : 8;
+      if ( stats.queued != queued or stats.flushed != 4 or stats.dropped_overflow != 2
+           or stats.dropped_unresolved != 2 ) {
+        throw runtime_error( "wrong pending counters" );
+      }
+    }
+
+    // with ARP refresh on, mappings in use are confirmed by unicast ARP before they expire
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress busy_eth = random_private_ethernet_address();
+      const EthernetAddress idle_eth = random_private_ethernet_address();
+      const EthernetAddress silent_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.set_arp_refresh( 3000 ); // a probe at 27, 28, and 29 seconds
+
+      auto announce = [&]( const EthernetAddress& eth, const string& ip ) {
+        const auto reply = make_arp( ARPMessage::OPCODE_REPLY, eth, ip, local_eth, "10.0.0.1" );
+        iface.recv_frame( make_frame( eth, local_eth, EthernetHeader::TYPE_ARP, serialize( reply ) ) );
+      };
+      const auto datagram = make_datagram( "1.2.3.4", "5.6.7.8" );
+      auto expect_sent_to = [&]( const EthernetAddress& eth, uint16_t type, const string& what ) {
+        const auto frame = iface.maybe_send();
+        if ( not frame.has_value() or frame->header.dst != eth or frame->header.type != type ) {
+          throw runtime_error( what );
+        }
+      };
+      auto expect_nothing_sent = [&]( const string& what ) {
+        if ( iface.maybe_send().has_value() ) {
+          throw runtime_error( what );
+        }
+      };
+
+      announce( busy_eth, "10.0.0.2" );
+      announce( idle_eth, "10.0.0.3" );
+      announce( silent_eth, "10.0.0.4" );
+      iface.tick( 1000 );
+      iface.send_datagram( datagram, Address( "10.0.0.2", 0 ) );
+      iface.send_datagram( datagram, Address( "10.0.0.4", 0 ) );
+      expect_sent_to( busy_eth, EthernetHeader::TYPE_IPv4, "datagram not sent to resolved neighbor" );
+      expect_sent_to( silent_eth, EthernetHeader::TYPE_IPv4, "datagram not sent to resolved neighbor" );
+
+      iface.tick( 25999 );
+      expect_nothing_sent( "probe sent too early" );
+      iface.tick( 1 );
+      expect_sent_to( busy_eth, EthernetHeader::TYPE_ARP, "no unicast probe for a mapping in use" );
+      expect_sent_to( silent_eth, EthernetHeader::TYPE_ARP, "no unicast probe for a mapping in use" );
+      expect_nothing_sent( "probe sent for an idle mapping" );
+
+      // the mapping stays usable while it is being confirmed, and the reply renews it
+      iface.tick( 500 );
+      iface.send_datagram( datagram, Address( "10.0.0.2", 0 ) );
+      expect_sent_to( busy_eth, EthernetHeader::TYPE_IPv4, "stale mapping was not used" );
+      announce( busy_eth, "10.0.0.2" );
+
+      iface.tick( 2500 ); // 30 seconds in
+      expect_sent_to( silent_eth, EthernetHeader::TYPE_ARP, "unanswered probe was not repeated" );
+      expect_sent_to( silent_eth, EthernetHeader::TYPE_ARP, "unanswered probe was not repeated" );
+      expect_nothing_sent( "too many probes" );
+      if ( iface.neighbors() != 1 ) {
+        throw runtime_error( "unconfirmed mappings were not forgotten" );
+      }
+
+      iface.tick( 20000 );
+      iface.send_datagram( datagram, Address( "10.0.0.2", 0 ) );
+      expect_sent_to( busy_eth, EthernetHeader::TYPE_IPv4, "renewed mapping expired" );
+      iface.send_datagram( datagram, Address( "10.0.0.4", 0 ) );
+      expect_sent_to( ETHERNET_BROADCAST, EthernetHeader::TYPE_ARP, "expired mapping was used" );
+    }
+
+    // static neighbors never expire, and ARP does not change them
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress gateway_eth = random_private_ethernet_address();
+      const EthernetAddress impostor_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      const auto datagram = make_datagram( "1.2.3.4", "5.6.7.8" );
+
+      iface.send_datagram( datagram, Address( "10.0.0.254", 0 ) ); // queued behind an ARP request
+      iface.add_static_neighbor( Address( "10.0.0.254", 0 ), gateway_eth );
+      iface.tick( 600 * 1000 );
+      const auto reply = make_arp( ARPMessage::OPCODE_REPLY, impostor_eth, "10.0.0.254", local_eth, "10.0.0.1" );
+      iface.recv_frame( make_frame( impostor_eth, local_eth, EthernetHeader::TYPE_ARP, serialize( reply ) ) );
+      iface.send_datagram( datagram, Address( "10.0.0.254", 0 ) );
+
+      vector<EthernetFrame> sent;
+      while ( auto frame = iface.maybe_send() ) {
+        sent.push_back( move( *frame ) );
+      }
+      if ( sent.size() != 3 or sent[0].header.type != EthernetHeader::TYPE_ARP or sent[1].header.dst != gateway_eth
+           or sent[2].header.dst != gateway_eth ) {
+        throw runtime_error( "static neighbor was not used, or was changed" );
+      }
+    }
+
+    // frames can be received and drained in bursts
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.add_static_neighbor( Address( "10.0.0.2", 0 ), remote_eth );
+
+      vector<EthernetFrame> burst;
+      for ( unsigned i = 0; i < 10; i++ ) {
+        const auto dgram = make_datagram( "10.0.0.2", "10.0.0." + to_string( 100 + i ) );
+        burst.push_back( make_frame( remote_eth, local_eth, EthernetHeader::TYPE_IPv4, serialize( dgram ) ) );
+      }
+      burst.push_back( make_frame( remote_eth,
+                                   random_private_ethernet_address(), // not for us
+                                   EthernetHeader::TYPE_IPv4,
+                                   serialize( make_datagram( "10.0.0.2", "10.0.0.1" ) ) ) );
+
+      vector<InternetDatagram> received;
+      if ( iface.recv_frames( burst, received ) != 10 or received.size() != 10 ) {
+        throw runtime_error( "recv_frames() did not return each datagram for us" );
+      }
+      for ( const auto& dgram : received ) {
+        iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+      }
+
+      vector<EthernetFrame> sent;
+      if ( iface.drain_frames( sent ) != 10 or iface.maybe_send().has_value() ) {
+        throw runtime_error( "drain_frames() did not take every frame" );
+      }
+      for ( unsigned i = 0; i < 10; i++ ) {
+        InternetDatagram dgram;
+        if ( not parse( dgram, sent[i].payload ) or dgram.header.dst != received[i].header.dst ) {
+          throw runtime_error( "drain_frames() reordered frames" );
+        }
+      }
+    }
+
+    // a frame shares its datagram's payload rather than copying it
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.add_static_neighbor( Address( "10.0.0.2", 0 ), remote_eth );
+
+      const auto dgram = make_datagram( "10.0.0.1", "10.0.0.2" );
+      iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+      const auto frame = iface.maybe_send();
+      if ( not frame.has_value() or frame->payload.size() != 2 or frame->payload[0].size() != IPv4Header::LENGTH
+           or string_view( frame->payload[1] ).data() != string_view( dgram.payload[0] ).data() ) {
+        throw runtime_error( "frame does not share the datagram's payload" );
+      }
+    }
+
+    // datagrams over the MTU are dropped, and counted
+    {
+      const EthernetAddress local_eth = random_private_ethernet_address();
+      const EthernetAddress remote_eth = random_private_ethernet_address();
+      NetworkInterface iface { local_eth, Address( "10.0.0.1", 0 ) };
+      iface.add_static_neighbor( Address( "10.0.0.2", 0 ), remote_eth );
+      iface.set_mtu( 100 );
+
+      auto dgram = make_datagram( "10.0.0.1", "10.0.0.2" );
+      dgram.payload.front() = string( 100 - IPv4Header::LENGTH, 'x' );
+      dgram.header.len = 100;
+      dgram.header.compute_checksum();
+      iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+      if ( not iface.maybe_send().has_value() or iface.oversized_dropped() != 0 ) {
+        throw runtime_error( "a datagram of exactly the MTU was not sent" );
+      }
+
+      dgram.payload.front() = string( 101 - IPv4Header::LENGTH, 'x' );
+      dgram.header.len = 101;
+      dgram.header.compute_checksum();
+      iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+      iface.send_datagram( dgram, Address( "10.0.0.2", 0 ) );
+      if ( iface.maybe_send().has_value() or iface.oversized_dropped() != 2 ) {
+        throw runtime_error( "datagrams over the MTU were not dropped and counted" );
+      }
+    }
   } catch ( const exception& e ) {
     cerr << e.what() << endl;
     return EXIT_FAILURE;
@@ -0,0 +1,151 @@
+#include "fd_adapter.hh"
+#include "ipv4_datagram.hh"
+#include "parser.hh"
+#include "pcap_fd_adapter.hh"
+#include "pcap_writer.hh"
+#include "tcp_over_ip.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void expect( bool cond, const string& what )
+{
+  if ( not cond ) {
+    throw runtime_error( what );
+  }
+}
+
+// An adapter that hands out queued segments and keeps what is written to it
+class StubAdapter : public FdAdapterBase
+{
+public:
+  deque<TCPSegment> to_read {};
+  vector<TCPSegment> written {};
+
+  optional<TCPSegment> read()
+  {
+    if ( to_read.empty() ) {
+      return {};
+    }
+    auto seg = to_read.front();
+    to_read.pop_front();
+    return seg;
+  }
+  void write( TCPSegment& seg ) { written.push_back( seg ); }
+  void write( vector<TCPSegment>& segs ) { written.insert( written.end(), segs.begin(), segs.end() ); }
+};
+
+TCPSegment data_segment( const string& payload, uint16_t src_port = 0, uint16_t dst_port = 0 )
+{
+  TCPSegment seg;
+  seg.sender_message.seqno = Wrap32 { 1000 };
+  seg.sender_message.payload = payload;
+  seg.receiver_message.ackno = Wrap32 { 2000 };
+  seg.receiver_message.window_size = 4096;
+  seg.udinfo.src_port = src_port;
+  seg.udinfo.dst_port = dst_port;
+  return seg;
+}
+
+template<typename T>
+T host_order( const string& bytes, size_t offset )
+{
+  T value {};
+  memcpy( &value, bytes.data() + offset, sizeof( T ) );
+  return value;
+}
+
+int main()
+{
+  try {
+    const uint32_t local_ip = 0x0a000001;
+    const uint32_t remote_ip = 0x0a000002;
+    const string path = "pcap_fd_adapter_test.pcap";
+
+    {
+      StubAdapter stub;
+      stub.config_mut().source = Address { "10.0.0.1", 1000 };
+      stub.config_mut().destination = Address { "10.0.0.2", 80 };
+      stub.to_read.push_back( data_segment( "response one", 80, 1000 ) );
+      stub.to_read.push_back( data_segment( "response two", 80, 1000 ) );
+
+      PcapFdAdapter<StubAdapter> adapter { move( stub ), path };
+      expect( adapter.capturing(), "adapter should be capturing" );
+
+      auto seg = data_segment( "request" );
+      adapter.write( seg );
+      expect( adapter.read().has_value() and adapter.read().has_value(), "reads did not pass through" );
+      vector<TCPSegment> batch { data_segment( "more" ), data_segment( "and more" ) };
+      adapter.write( batch );
+      expect( adapter.adapter().written.size() == 3, "writes did not pass through" );
+    } // the writer flushes everything on destruction
+
+    ifstream file { path, ios::binary };
+    stringstream contents_stream;
+    contents_stream << file.rdbuf();
+    file.close();
+    remove( path.c_str() );
+    const string contents = contents_stream.str();
+
+    expect( contents.size() >= PcapWriter::FILE_HEADER_LENGTH, "file header missing" );
+    expect( host_order<uint32_t>( contents, 0 ) == PcapWriter::MAGIC_NANOSECONDS, "wrong magic" );
+    expect( host_order<uint32_t>( contents, 20 ) == PcapWriter::LINKTYPE_RAW, "wrong link type" );
+
+    const vector<pair<string, bool>> expected { { "request", true },
+                                                { "response one", false },
+                                                { "response two", false },
+                                                { "more", true },
+                                                { "and more", true } };
+    size_t offset = PcapWriter::FILE_HEADER_LENGTH;
+    uint64_t last_ns = 0;
+    for ( const auto& [payload, outbound] : expected ) {
+      expect( offset + PcapWriter::RECORD_HEADER_LENGTH <= contents.size(), "record missing" );
+      const uint32_t nsec = host_order<uint32_t>( contents, offset + 4 );
+      const uint64_t ns = host_order<uint32_t>( contents, offset ) * 1'000'000'000ULL + nsec;
+      const uint32_t captured = host_order<uint32_t>( contents, offset + 8 );
+      const uint32_t length = host_order<uint32_t>( contents, offset + 12 );
+      expect( nsec < 1'000'000'000 and ns >= last_ns, "bad timestamp" );
+      expect( captured == length, "packet was truncated" );
+      last_ns = ns;
+      offset += PcapWriter::RECORD_HEADER_LENGTH;
+
+      InternetDatagram dgram;
+      expect( parse( dgram, { Buffer { contents.substr( offset, captured ) } } ), "record is not IPv4" );
+      offset += captured;
+      const auto seg = parse_tcp_in_ip( dgram );
+      expect( seg.has_value(), "record does not carry a valid TCP segment" );
+      expect( string_view( seg->sender_message.payload ) == payload, "records out of order" );
+      expect( dgram.header.src == ( outbound ? local_ip : remote_ip )
+                and dgram.header.dst == ( outbound ? remote_ip : local_ip ),
+              "wrong addresses" );
+      expect( seg->udinfo.src_port == ( outbound ? 1000 : 80 ) and seg->udinfo.dst_port == ( outbound ? 80 : 1000 ),
+              "wrong ports" );
+    }
+    expect( offset == contents.size(), "unexpected records" );
+
+    // Without a capture file, the adapter only passes segments through
+    {
+      PcapFdAdapter<StubAdapter> adapter { StubAdapter {}, "" };
+      expect( not adapter.capturing(), "adapter should not be capturing" );
+      auto seg = data_segment( "x" );
+      adapter.write( seg );
+      expect( adapter.adapter().written.size() == 1, "write did not pass through" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
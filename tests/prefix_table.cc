@@ -0,0 +1,205 @@
+#include "prefix_table.hh"
+#include "random.hh"
+#include "router.hh"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+struct Route
+{
+  uint32_t prefix;
+  uint8_t length;
+};
+
+uint32_t mask( uint8_t length )
+{
+  return length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+}
+
+// The index of the longest route matching `address` (the first added, of equally long ones), by scanning them all
+optional<size_t> linear_scan( const vector<Route>& routes, uint32_t address )
+{
+  optional<size_t> best;
+  for ( size_t i = 0; i < routes.size(); i++ ) {
+    const auto& r = routes[i];
+    if ( ( address & mask( r.length ) ) == ( r.prefix & mask( r.length ) )
+         and ( not best.has_value() or r.length > routes[*best].length ) ) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+// Random routes, clustered (as real tables are) so that prefixes nest and repeat, with host bits left set
+vector<Route> random_routes( default_random_engine& rd, size_t count )
+{
+  uniform_int_distribution<uint32_t> address;
+  uniform_int_distribution<int> length { 0, 32 };
+  vector<uint32_t> bases;
+  for ( int i = 0; i < 8; i++ ) {
+    bases.push_back( address( rd ) );
+  }
+
+  vector<Route> routes;
+  for ( size_t i = 0; i < count; i++ ) {
+    const uint32_t base = bases[i % bases.size()];
+    const auto len = static_cast<uint8_t>( length( rd ) );
+    // vary the bits below the top 8 of the base, keeping the cluster together
+    routes.push_back( { base ^ ( address( rd ) & ( UINT32_MAX >> 8 ) & ~mask( len / 2 ) ), len } );
+  }
+  return routes;
+}
+
+// Addresses to look up: random ones, and ones at and around the edges of each route
+vector<uint32_t> probe_addresses( default_random_engine& rd, const vector<Route>& routes )
+{
+  uniform_int_distribution<uint32_t> address;
+  vector<uint32_t> addresses;
+  for ( int i = 0; i < 2000; i++ ) {
+    addresses.push_back( address( rd ) );
+  }
+  for ( const auto& r : routes ) {
+    const uint32_t first = r.prefix & mask( r.length );
+    const uint32_t last = first | ~mask( r.length );
+    for ( const uint32_t a : { first, last, first - 1, last + 1, first | ( address( rd ) & ~mask( r.length ) ) } ) {
+      addresses.push_back( a );
+    }
+  }
+  return addresses;
+}
+
+void check_table( default_random_engine& rd, size_t count )
+{
+  const auto routes = random_routes( rd, count );
+  PrefixTable table;
+  for ( size_t i = 0; i < routes.size(); i++ ) {
+    table.insert( routes[i].prefix, routes[i].length, static_cast<PrefixTable::Value>( i ) );
+  }
+
+  for ( const uint32_t a : probe_addresses( rd, routes ) ) {
+    const auto expected = linear_scan( routes, a );
+    const auto found = table.find( a );
+    if ( expected.has_value() ? found != *expected : found != PrefixTable::NONE ) {
+      throw runtime_error( "PrefixTable disagrees with linear scan for " + Address::from_ipv4_numeric( a ).ip() );
+    }
+  }
+
+  table.clear();
+  if ( table.find( routes.front().prefix ) != PrefixTable::NONE or table.chunks() != 0 ) {
+    throw runtime_error( "clear() left routes behind" );
+  }
+}
+
+// The router answers with each route's next hop (or the destination itself, if directly attached) and interface
+void check_router( default_random_engine& rd )
+{
+  const auto routes = random_routes( rd, 300 );
+  Router router;
+  for ( size_t i = 0; i < routes.size(); i++ ) {
+    const auto next_hop = i % 3 == 0 ? optional<Address> {} : Address::from_ipv4_numeric( 0x0a000000 + i );
+    router.add_route( routes[i].prefix, routes[i].length, next_hop, i % 4 );
+  }
+
+  for ( const uint32_t a : probe_addresses( rd, routes ) ) {
+    const auto expected = linear_scan( routes, a );
+    const auto found = router.match_rt_entry( a );
+    if ( found.has_value() != expected.has_value() ) {
+      throw runtime_error( "router disagrees with linear scan on whether a route matches" );
+    }
+    if ( not expected.has_value() ) {
+      continue;
+    }
+    const size_t i = *expected;
+    const uint32_t next_hop = i % 3 == 0 ? a : 0x0a000000 + i;
+    if ( found->first.ipv4_numeric() != next_hop or found->second != i % 4 ) {
+      throw runtime_error( "router disagrees with linear scan on a route" );
+    }
+  }
+}
+
+// Write `routes` as a route dump (route i with the next hop and interface check_router() gives it), then `extra`
+void write_dump( const string& path, const vector<Route>& routes, const string& extra = "" )
+{
+  ofstream file { path };
+  file << "# prefix next-hop interface\n\n";
+  for ( size_t i = 0; i < routes.size(); i++ ) {
+    const string next_hop = i % 3 == 0 ? "-" : Address::from_ipv4_numeric( 0x0a000000 + i ).ip();
+    file << Address::from_ipv4_numeric( routes[i].prefix ).ip() << "/" << static_cast<int>( routes[i].length )
+         << " " << next_hop << "\t" << i % 4 << "\n";
+  }
+  file << extra;
+}
+
+// A route dump loads into the same table as adding its routes one by one; a malformed dump is refused, and leaves
+// the routes as they were
+void check_load_routes( default_random_engine& rd )
+{
+  const string path = "prefix_table_routes." + to_string( rd() ) + ".txt";
+  const auto routes = random_routes( rd, 300 );
+  const auto probes = probe_addresses( rd, routes );
+  Router router;
+  for ( uint8_t i = 0; i < 4; i++ ) {
+    router.add_interface( { EthernetAddress { 0x02, 0, 0, 0, 0, i }, Address::from_ipv4_numeric( 0x0a000001 ) } );
+  }
+  const auto check_routes = [&]( const string& when ) {
+    for ( const uint32_t a : probes ) {
+      const auto expected = linear_scan( routes, a );
+      const auto found = router.match_rt_entry( a );
+      if ( found.has_value() != expected.has_value()
+           or ( expected.has_value()
+                and ( found->first.ipv4_numeric() != ( *expected % 3 == 0 ? a : 0x0a000000 + *expected )
+                      or found->second != *expected % 4 ) ) ) {
+        throw runtime_error( "router disagrees with linear scan " + when );
+      }
+    }
+  };
+
+  router.add_route( 0, 0, Address::from_ipv4_numeric( 0x01020304 ), 7 ); // replaced by the load
+  write_dump( path, routes );
+  if ( router.load_routes( path ) != routes.size() ) {
+    throw runtime_error( "load_routes() miscounted the routes" );
+  }
+  check_routes( "after load_routes()" );
+
+  for ( const string bad :
+        { "10.0.0.0/33 - 1", "10.0.0/8 - 1", "10.0.0.0/8 10.0.0.256 1", "10.0.0.0/8 -", "10.0.0.0/8 - 4", "x" } ) {
+    write_dump( path, { { 0, 0 } }, bad + "\n" );
+    bool threw = false;
+    try {
+      router.load_routes( path );
+    } catch ( const runtime_error& ) {
+      threw = true;
+    }
+    if ( not threw ) {
+      throw runtime_error( "load_routes() accepted a malformed route: " + bad );
+    }
+  }
+  check_routes( "after a failed load_routes()" );
+
+  remove( path.c_str() );
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    for ( const size_t count : { 1, 10, 100, 1000 } ) {
+      check_table( rd, count );
+    }
+    check_router( rd );
+    check_load_routes( rd );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
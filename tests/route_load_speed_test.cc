@@ -0,0 +1,67 @@
+#include "random.hh"
+#include "router.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+using namespace std::chrono;
+
+// Write `count` random routes, mostly /16 to /24 as in the real Internet table, as a route dump
+void write_dump( const string& path, default_random_engine& rd, const size_t count )
+{
+  uniform_int_distribution<uint32_t> address;
+  uniform_int_distribution<int> length { 16, 24 };
+  ofstream file { path };
+  for ( size_t i = 0; i < count; i++ ) {
+    file << Address::from_ipv4_numeric( address( rd ) ).ip() << "/" << length( rd ) << " "
+         << ( i % 3 == 0 ? "-" : Address::from_ipv4_numeric( 0x0a000000 + i ).ip() ) << " " << i % 4 << "\n";
+  }
+}
+
+int main()
+{
+  try {
+    constexpr size_t count = 1'000'000;
+    auto rd = get_random_engine();
+    const string path = "route_load_speed_test." + to_string( rd() ) + ".txt";
+    write_dump( path, rd, count );
+
+    Router router;
+    for ( uint8_t i = 0; i < 4; i++ ) {
+      router.add_interface( { EthernetAddress { 0x02, 0, 0, 0, 0, i }, Address::from_ipv4_numeric( 0x0a000001 ) } );
+    }
+
+    // The fastest of a few loads, so that one the scheduler interrupts does not count
+    double seconds = numeric_limits<double>::max();
+    for ( int run = 0; run < 3; run++ ) {
+      const auto start_time = steady_clock::now();
+      const size_t loaded = router.load_routes( path );
+      const auto stop_time = steady_clock::now();
+      if ( loaded != count ) {
+        throw runtime_error( "load_routes() miscounted the routes" );
+      }
+      seconds = min( seconds, duration_cast<duration<double>>( stop_time - start_time ).count() );
+    }
+    remove( path.c_str() );
+
+    cout << fixed << setprecision( 2 ) << "Router::load_routes: " << count << " routes in " << seconds << " s.\n";
+
+    // About half a second here, so this leaves room for a slower machine
+    if ( seconds > 1 ) {
+      throw runtime_error( "loading a full Internet table took too long" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,74 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "A batch stops at max_count, and the next one picks up from there", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 10000 ) );
+      test.execute( Push { string( 5000, 'x' ) } );
+      test.execute( ExpectBatch { 0, 0, isn + 1, 0 } );
+      test.execute( ExpectBatch { 3, 3, isn + 1, 3000 } );
+      test.execute( ExpectBatch { 8, 2, isn + 3001, 2000 } );
+      test.execute( ExpectBatch { 8, 0, isn + 5001, 0 } );
+      test.execute( ExpectSeqnosInFlight { 5000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "A batch stays within the window", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 2500 ) );
+      test.execute( Push { string( 6000, 'x' ) } );
+      test.execute( ExpectBatch { 64, 3, isn + 1, 2500 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 2001 }.with_win( 2500 ) );
+      test.execute( ExpectBatch { 64, 2, isn + 2501, 2000 } );
+      test.execute( ExpectSeqnosInFlight { 2500 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "A retransmission leads the batch", cfg };
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 3000 ) );
+      test.execute( Push { string( 2000, 'x' ) } );
+      test.execute( ExpectBatch { 64, 2, isn + 1, 2000 } );
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( Push { string( 1000, 'y' ) } );
+      test.execute( ExpectBatch { 1, 1, isn + 1, 1000 } );
+      test.execute( ExpectBatch { 64, 1, isn + 2001, 1000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
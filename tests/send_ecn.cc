@@ -0,0 +1,112 @@
+#include "random.hh"
+#include "sender_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "Congestion window starts at ten segments and grows in slow start", cfg };
+      test.execute( EnableCongestionControl {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 10000 } );
+      test.execute( Push( string( 20000, 'x' ) ) );
+      for ( uint32_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+      test.execute( AckReceived { isn + 2001 }.with_win( 60000 ) );
+      test.execute( ExpectCwnd { 12000 } );
+      for ( uint32_t i = 10; i < 14; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "ECE halves the window once per window of data", cfg };
+      test.execute( EnableCongestionControl {} );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      test.execute( Push( string( 20000, 'x' ) ) );
+      for ( uint32_t i = 0; i < 10; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      test.execute( AckReceived { isn + 2001 }.with_win( 60000 ) );
+      test.execute( EcnEcho { true, 2000, true } );
+      test.execute( ExpectCwnd { 6000 } );
+      for ( uint32_t i = 10; i < 14; i++ ) {
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 1 + 1000 * i ) );
+      }
+      // more marks from the same window of data are not a new congestion signal
+      test.execute( AckReceived { isn + 5001 }.with_win( 60000 ) );
+      test.execute( EcnEcho { true, 3000, false } );
+      test.execute( ExpectCwnd { 6000 } );
+      test.execute( ExpectNoSegment {} );
+      // congestion avoidance: one more segment per window acknowledged
+      test.execute( AckReceived { isn + 8001 }.with_win( 60000 ) );
+      test.execute( EcnEcho { false, 3000, false } );
+      test.execute( ExpectCwnd { 7000 } );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + 14001 ) );
+      test.execute( ExpectNoSegment {} );
+      // once the marked window is acknowledged, ECE counts again
+      test.execute( AckReceived { isn + 15001 }.with_win( 60000 ) );
+      test.execute( EcnEcho { true, 7000, true } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPSenderTestHarness test { "DCTCP cuts the window by the fraction of marked bytes", cfg };
+      test.execute( EnableCongestionControl { true } );
+      test.execute( Push {} );
+      test.execute( ExpectMessage {}.with_syn( true ).with_payload_size( 0 ).with_seqno( isn ) );
+      test.execute( AckReceived { isn + 1 }.with_win( 60000 ) );
+      // sixteen unmarked windows of data bring alpha from 1 down to about 0.36
+      uint32_t acked = 1;
+      for ( unsigned i = 0; i < 16; i++ ) {
+        test.execute( Push( string( 1000, 'x' ) ) );
+        test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + acked ) );
+        acked += 1000;
+        test.execute( AckReceived { isn + acked }.with_win( 60000 ) );
+        test.execute( EcnEcho { false, 1000, false } );
+      }
+      // one segment at a time never fills the window, so it does not grow
+      test.execute( ExpectCwnd { 10000 } );
+      test.execute( Push( string( 1000, 'x' ) ) );
+      test.execute( ExpectMessage {}.with_payload_size( 1000 ).with_seqno( isn + acked ) );
+      acked += 1000;
+      test.execute( AckReceived { isn + acked }.with_win( 60000 ) );
+      // this fully marked window lifts alpha to about 0.4: 10000 * ( 1 - 0.4 / 2 )
+      test.execute( EcnEcho { true, 1000, true } );
+      test.execute( ExpectCwnd { 7994 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -9,6 +9,7 @@
 #include <optional>
 #include <sstream>
 #include <utility>
+#include <vector>
 
 const unsigned int DEFAULT_TEST_WINDOW = 137;
 
@@ -187,6 +188,79 @@ struct AckReceived : public Receive
   explicit AckReceived( Wrap32 ackno ) : Receive( { ackno, DEFAULT_TEST_WINDOW } ) {}
 };
 
+struct SackReceived : public Action<StreamAndSender>
+{
+  Wrap32 left_, right_;
+
+  SackReceived( Wrap32 left, Wrap32 right ) : left_( left ), right_( right ) {}
+  std::string description() const override
+  {
+    std::ostringstream desc;
+    desc << "receive SACK block [" << left_ << ", " << right_ << ")";
+    return desc.str();
+  }
+  void execute( StreamAndSender& ss ) const override { ss.second.receive_sack( left_, right_ ); }
+};
+
+struct RttSample : public Action<StreamAndSender>
+{
+  uint64_t ms_;
+
+  explicit RttSample( uint64_t ms ) : ms_( ms ) {}
+  std::string description() const override { return "RTT sample of " + std::to_string( ms_ ) + " ms"; }
+  void execute( StreamAndSender& ss ) const override { ss.second.rtt_sample( ms_ ); }
+};
+
+struct EnableRackTlp : public Action<StreamAndSender>
+{
+  std::string description() const override { return "enable RACK-TLP"; }
+  void execute( StreamAndSender& ss ) const override { ss.second.set_rack_tlp( true ); }
+};
+
+struct EnableCongestionControl : public Action<StreamAndSender>
+{
+  bool dctcp_;
+
+  explicit EnableCongestionControl( bool dctcp = false ) : dctcp_( dctcp ) {}
+  std::string description() const override
+  {
+    return std::string( "enable congestion control" ) + ( dctcp_ ? " with DCTCP" : "" );
+  }
+  void execute( StreamAndSender& ss ) const override { ss.second.enable_congestion_control( dctcp_ ); }
+};
+
+struct EcnEcho : public Action<StreamAndSender>
+{
+  bool ece_;
+  uint64_t acked_bytes_;
+  bool reduced_;
+
+  EcnEcho( bool ece, uint64_t acked_bytes, bool reduced )
+    : ece_( ece ), acked_bytes_( acked_bytes ), reduced_( reduced )
+  {}
+  std::string description() const override
+  {
+    std::ostringstream desc;
+    desc << "ACK of " << acked_bytes_ << " bytes " << ( ece_ ? "with" : "without" ) << " ECE should "
+         << ( reduced_ ? "" : "not " ) << "reduce the congestion window";
+    return desc.str();
+  }
+  void execute( StreamAndSender& ss ) const override
+  {
+    if ( ss.second.ecn_echo( ece_, acked_bytes_ ) != reduced_ ) {
+      throw ExpectationViolation( std::string( "congestion window was " ) + ( reduced_ ? "not " : "" )
+                                  + "reduced" );
+    }
+  }
+};
+
+struct ExpectCwnd : public ExpectNumber<StreamAndSender, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "cwnd"; }
+  uint64_t value( StreamAndSender& ss ) const override { return ss.second.cwnd().value_or( 0 ); }
+};
+
 struct Close : public Push
 {
   Close() : Push( "" ) { with_close(); }
@@ -301,6 +375,49 @@ struct ExpectMessage : public Expectation<StreamAndSender>
   }
 };
 
+// The batched maybe_send() appends `count` messages (asked for at most `max_count`) to what is already in
+// its vector: consecutive, starting at `seqno`, and `bytes` of payload in all
+struct ExpectBatch : public Expectation<StreamAndSender>
+{
+  size_t max_count_;
+  size_t count_;
+  Wrap32 seqno_;
+  size_t bytes_;
+
+  ExpectBatch( size_t max_count, size_t count, Wrap32 seqno, size_t bytes )
+    : max_count_( max_count ), count_( count ), seqno_( seqno ), bytes_( bytes )
+  {}
+
+  std::string description() const override
+  {
+    std::ostringstream desc;
+    desc << "batch of up to " << max_count_ << " has " << count_ << " messages from seqno=" << seqno_ << " with "
+         << bytes_ << " bytes of payload";
+    return desc.str();
+  }
+
+  void execute( StreamAndSender& ss ) const override
+  {
+    std::vector<TCPSenderMessage> out { TCPSenderMessage {} };
+    const size_t added = ss.second.maybe_send( out, max_count_ );
+    if ( added != count_ or out.size() != count_ + 1 ) {
+      throw ExpectationViolation( "messages in the batch", count_, added );
+    }
+    Wrap32 seqno = seqno_;
+    size_t bytes = 0;
+    for ( size_t i = 1; i < out.size(); i++ ) {
+      if ( out[i].seqno != seqno ) {
+        throw ExpectationViolation( "sequence number of message " + std::to_string( i - 1 ), seqno, out[i].seqno );
+      }
+      seqno = seqno + out[i].sequence_length();
+      bytes += out[i].payload.size();
+    }
+    if ( bytes != bytes_ ) {
+      throw ExpectationViolation( "bytes of payload in the batch", bytes_, bytes );
+    }
+  }
+};
+
 class TCPSenderTestHarness : public TestHarness<StreamAndSender>
 {
 public:
@@ -0,0 +1,225 @@
+#include "random.hh"
+#include "tcp_connection_mux.hh"
+#include "tcp_connection_table.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace std;
+
+static auto as_tuple( const FourTuple& t )
+{
+  return make_tuple( t.local_ip, t.remote_ip, t.local_port, t.remote_port );
+}
+
+// Drive the table and a std::map with the same random inserts and erases (over a key space small
+// enough that keys keep coming back), checking every answer, including batched lookups.
+void check_against_model( default_random_engine& rd )
+{
+  TCPConnectionTable table;
+  map<tuple<uint32_t, uint32_t, uint16_t, uint16_t>, uint32_t> model;
+
+  uniform_int_distribution<uint32_t> ip { 0, 3 };
+  uniform_int_distribution<uint16_t> port { 1000, 1255 };
+  uniform_int_distribution<int> op { 0, 9 };
+  auto random_key = [&] { return FourTuple { ip( rd ), ip( rd ), port( rd ), 80 }; };
+
+  vector<FourTuple> keys;
+  vector<uint32_t> values;
+  for ( uint32_t i = 0; i < 30000; i++ ) {
+    const auto key = random_key();
+    const auto it = model.find( as_tuple( key ) );
+    switch ( op( rd ) ) {
+      case 0:
+      case 1:
+      case 2:
+        if ( table.erase( key ) != ( it != model.end() ) ) {
+          throw runtime_error( "erase() disagrees with model" );
+        }
+        if ( it != model.end() ) {
+          model.erase( it );
+        }
+        break;
+      case 3:
+      case 4:
+      case 5:
+        if ( table.insert( key, i ) != ( it == model.end() ) ) {
+          throw runtime_error( "insert() disagrees with model" );
+        }
+        model.emplace( as_tuple( key ), i );
+        break;
+      default: {
+        keys.clear();
+        for ( int k = 0; k < 40; k++ ) {
+          keys.push_back( random_key() );
+        }
+        values.assign( keys.size(), 0 );
+        table.find_batch( keys, values );
+        for ( size_t k = 0; k < keys.size(); k++ ) {
+          const auto m = model.find( as_tuple( keys[k] ) );
+          const uint32_t expected = m == model.end() ? TCPConnectionTable::NONE : m->second;
+          if ( table.find( keys[k] ) != expected or values[k] != expected ) {
+            throw runtime_error( "lookup disagrees with model" );
+          }
+        }
+        break;
+      }
+    }
+    if ( table.size() != model.size() ) {
+      throw runtime_error( "size() disagrees with model" );
+    }
+  }
+}
+
+// Connect many clients on one mux to as many servers on another, move data both ways over the two
+// "adapters", and check that every byte reaches the connection it was written on.
+void check_mux()
+{
+  constexpr uint32_t client_ip = 0x0a000001;
+  constexpr uint32_t server_ip = 0x0a000002;
+  constexpr uint16_t connections = 200;
+
+  TCPConnectionMux clients, servers;
+  vector<TCPConnectionMux::ConnectionId> client_ids, server_ids;
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    const FourTuple tuple { client_ip, server_ip, static_cast<uint16_t>( 40000 + i ), 443 };
+    server_ids.push_back( servers.add( { server_ip, client_ip, 443, tuple.local_port }, TCPConfig {} ) );
+    client_ids.push_back( clients.connect( tuple, TCPConfig {} ) );
+  }
+
+  // A datagram for nobody is not delivered (and that client starts over)
+  vector<InternetDatagram> to_server, to_client;
+  clients.collect( to_server );
+  to_server.front().header.dst = 0x0a000009;
+  to_server.front().header.compute_checksum();
+  if ( servers.receive( to_server.front() ).has_value() ) {
+    throw runtime_error( "datagram for an unknown 4-tuple was delivered" );
+  }
+  to_server.erase( to_server.begin() );
+  clients.remove( client_ids.front() );
+  client_ids.front() = clients.connect( { client_ip, server_ip, 40000, 443 }, TCPConfig {} );
+
+  auto exchange = [&] {
+    for ( int round = 0; round < 50; round++ ) {
+      clients.collect( to_server );
+      if ( servers.receive( to_server ) != to_server.size() ) {
+        throw runtime_error( "datagram for a known connection was not delivered" );
+      }
+      servers.collect( to_client );
+      if ( clients.receive( to_client ) != to_client.size() ) {
+        throw runtime_error( "datagram for a known connection was not delivered" );
+      }
+      if ( to_server.empty() and to_client.empty() ) {
+        return;
+      }
+      to_server.clear();
+      to_client.clear();
+    }
+    throw runtime_error( "connections did not go quiet" );
+  };
+  exchange();
+
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    clients.peer( client_ids[i] ).outbound_writer().push( "request " + to_string( i ) );
+    clients.mark_ready( client_ids[i] );
+    servers.peer( server_ids[i] ).outbound_writer().push( "response " + to_string( i ) );
+    servers.mark_ready( server_ids[i] );
+  }
+  exchange();
+
+  for ( uint16_t i = 0; i < connections; i++ ) {
+    auto& server_in = servers.peer( server_ids[i] ).inbound_reader();
+    auto& client_in = clients.peer( client_ids[i] ).inbound_reader();
+    if ( server_in.peek() != "request " + to_string( i ) or client_in.peek() != "response " + to_string( i ) ) {
+      throw runtime_error( "data arrived on the wrong connection" );
+    }
+  }
+
+  if ( clients.size() != connections or servers.size() != connections ) {
+    throw runtime_error( "unexpected connection count" );
+  }
+
+  // Once the delayed ACKs are out, time passing touches no connection
+  clients.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+  servers.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+  exchange();
+  clients.tick( 10 * TCPConfig::TIMEOUT_DFLT );
+  servers.tick( 10 * TCPConfig::TIMEOUT_DFLT );
+  if ( clients.pending_size() != 0 or servers.pending_size() != 0 ) {
+    throw runtime_error( "tick() visited idle connections" );
+  }
+
+  // A lost segment is sent again by its connection alone, when its timers fire
+  clients.peer( client_ids[7] ).outbound_writer().push( "lost" );
+  clients.mark_ready( client_ids[7] );
+  clients.collect( to_server );
+  if ( to_server.size() != 1 ) {
+    throw runtime_error( "expected one segment" );
+  }
+  to_server.clear();
+  clients.tick( TCPConfig::TIMEOUT_DFLT );
+  if ( clients.pending_size() != 1 ) {
+    throw runtime_error( "tick() visited " + to_string( clients.pending_size() ) + " connections, expected 1" );
+  }
+  clients.collect( to_server );
+  if ( to_server.empty() or servers.receive( to_server ) != to_server.size() ) {
+    throw runtime_error( "lost segment was not retransmitted" );
+  }
+  if ( servers.peer( server_ids[7] ).inbound_reader().peek() != "request 7lost" ) {
+    throw runtime_error( "retransmission did not deliver the data" );
+  }
+  exchange();
+
+  // Closed connections are removed, the side that closed first only once it has lingered in TIME_WAIT
+  auto settle = [&] {
+    exchange();
+    clients.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+    servers.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+    exchange();
+  };
+  constexpr uint16_t closing = 10;
+  for ( uint16_t i = 10; i < 10 + closing; i++ ) {
+    clients.peer( client_ids[i] ).outbound_writer().close();
+    clients.mark_ready( client_ids[i] );
+  }
+  settle();
+  for ( uint16_t i = 10; i < 10 + closing; i++ ) {
+    servers.peer( server_ids[i] ).outbound_writer().close();
+    servers.mark_ready( server_ids[i] );
+  }
+  settle();
+  if ( servers.remove_inactive() != closing or clients.remove_inactive() != 0 ) {
+    throw runtime_error( "remove_inactive() removed the wrong connections" );
+  }
+  clients.tick( TCPConfig::TIME_WAIT_MS );
+  if ( clients.pending_size() != closing ) {
+    throw runtime_error( "TIME_WAIT expired on " + to_string( clients.pending_size() ) + " connections" );
+  }
+  clients.collect( to_server );
+  if ( not to_server.empty() or clients.remove_inactive() != closing or servers.remove_inactive() != 0 ) {
+    throw runtime_error( "remove_inactive() did not remove the connections done with TIME_WAIT" );
+  }
+  if ( clients.size() != connections - closing or servers.size() != connections - closing
+       or clients.find( { client_ip, server_ip, 40010, 443 } ).has_value() ) {
+    throw runtime_error( "unexpected connection count after remove_inactive()" );
+  }
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    check_against_model( rd );
+    check_mux();
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
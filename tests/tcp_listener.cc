@@ -0,0 +1,260 @@
+#include "tcp_connection_mux.hh"
+#include "tcp_listener.hh"
+#include "tcp_over_ip.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr uint32_t CLIENT_IP = 0x0a000001;
+static constexpr uint32_t SERVER_IP = 0x0a000002;
+static constexpr uint16_t SERVER_PORT = 80;
+
+void expect( bool cond, const string& what )
+{
+  if ( not cond ) {
+    throw runtime_error( what );
+  }
+}
+
+// A server (a listener on a mux) and a mux of clients, with datagrams carried between them in rounds
+struct Network
+{
+  TCPConnectionMux clients {};
+  TCPConnectionMux servers {};
+  TCPListener listener;
+  vector<InternetDatagram> to_server {}, to_client {};
+
+  explicit Network( const TCPConfig& server_cfg ) : listener( servers, SERVER_PORT, server_cfg ) {}
+
+  TCPConnectionMux::ConnectionId connect( uint16_t client_port )
+  {
+    return clients.connect( { CLIENT_IP, SERVER_IP, client_port, SERVER_PORT }, TCPConfig {} );
+  }
+
+  void exchange()
+  {
+    for ( int round = 0; round < 20; round++ ) {
+      clients.collect( to_server );
+      for ( const auto& dgram : to_server ) {
+        listener.receive( dgram );
+      }
+      servers.collect( to_client );
+      listener.collect( to_client );
+      clients.receive( to_client );
+      if ( to_server.empty() and to_client.empty() ) {
+        return;
+      }
+      to_server.clear();
+      to_client.clear();
+    }
+    throw runtime_error( "network did not go quiet" );
+  }
+
+  void tick( uint64_t ms )
+  {
+    clients.tick( ms );
+    servers.tick( ms );
+    listener.tick( ms );
+  }
+};
+
+// A bare SYN, with nobody behind it to complete the handshake
+InternetDatagram flood_syn( uint16_t client_port )
+{
+  TCPSegment syn;
+  syn.sender_message.SYN = true;
+  syn.sender_message.seqno = Wrap32 { 1000U * client_port };
+  syn.options.mss = 1460;
+  return wrap_tcp_in_ip( syn, { CLIENT_IP, SERVER_IP, client_port, SERVER_PORT } );
+}
+
+int main()
+{
+  try {
+    // More clients at once than the SYN queue holds: the rest get in with SYN cookies
+    {
+      TCPConfig cfg;
+      cfg.syn_backlog = 4;
+      Network net { cfg };
+      vector<TCPConnectionMux::ConnectionId> client_ids;
+      for ( uint16_t i = 0; i < 20; i++ ) {
+        client_ids.push_back( net.connect( 5000 + i ) );
+      }
+      net.exchange();
+      expect( net.listener.cookies_sent() == 16, "expected 16 SYN cookies" );
+      expect( net.listener.cookies_accepted() == 16, "expected 16 connections from SYN cookies" );
+      expect( net.listener.syn_queue_size() == 0, "SYN queue should be empty" );
+
+      vector<TCPConnectionMux::ConnectionId> server_ids;
+      while ( auto id = net.listener.accept() ) {
+        server_ids.push_back( id.value() );
+      }
+      expect( server_ids.size() == 20, "expected 20 accepted connections" );
+
+      for ( const auto id : server_ids ) {
+        const uint16_t port = net.servers.tuple( id ).remote_port;
+        net.servers.peer( id ).outbound_writer().push( "hello " + to_string( port ) );
+        net.servers.mark_ready( id );
+        expect( net.servers.peer( id ).sender().max_payload_size() >= 1400, "cookie lost the peer's MSS" );
+      }
+      net.exchange();
+      for ( uint16_t i = 0; i < 20; i++ ) {
+        expect( net.clients.peer( client_ids[i] ).inbound_reader().peek() == "hello " + to_string( 5000 + i ),
+                "data did not reach the right client" );
+      }
+    }
+
+    // A SYN flood stays within the SYN queue, and its half-open connections time out
+    {
+      TCPConfig cfg;
+      cfg.syn_backlog = 8;
+      Network net { cfg };
+      for ( uint16_t i = 0; i < 1000; i++ ) {
+        net.listener.receive( flood_syn( 10000 + i ) );
+      }
+      expect( net.listener.syn_queue_size() == 8, "SYN queue exceeded its backlog" );
+      expect( net.servers.size() == 8, "a flood created connections beyond the backlog" );
+      expect( net.listener.cookies_sent() == 992, "expected a cookie for every SYN beyond the backlog" );
+
+      // a legitimate client still gets in, by cookie
+      const auto client = net.connect( 4242 );
+      net.exchange();
+      expect( net.listener.accept().has_value(), "client was not accepted during the flood" );
+      expect( net.clients.peer( client ).sender().sequence_numbers_in_flight() == 0, "handshake incomplete" );
+
+      for ( int s = 0; s < 200; s++ ) {
+        net.tick( 1000 );
+        net.servers.collect( net.to_client );
+        net.to_client.clear();
+      }
+      expect( net.listener.syn_queue_size() == 0, "half-open connections did not time out" );
+      expect( net.servers.size() == 1, "half-open connections were not removed" );
+    }
+
+    // A forged or stale cookie creates nothing
+    {
+      TCPConfig cfg;
+      cfg.syn_backlog = 0;
+      Network net { cfg };
+      net.listener.receive( flood_syn( 7000 ) );
+      vector<InternetDatagram> replies;
+      net.listener.collect( replies );
+      expect( replies.size() == 1, "expected one cookie SYN-ACK" );
+      const auto synack = parse_tcp_in_ip( replies.front() );
+      expect( synack.has_value() and synack->sender_message.SYN, "cookie reply is not a SYN-ACK" );
+
+      auto ack_with = [&]( Wrap32 ackno ) {
+        TCPSegment ack;
+        ack.sender_message.seqno = Wrap32 { 1000U * 7000 + 1 };
+        ack.receiver_message.ackno = ackno;
+        ack.receiver_message.window_size = 1000;
+        return wrap_tcp_in_ip( ack, { CLIENT_IP, SERVER_IP, 7000, SERVER_PORT } );
+      };
+
+      net.listener.receive( ack_with( synack->sender_message.seqno + 2 ) );
+      expect( net.servers.size() == 0, "a forged cookie was accepted" );
+
+      net.tick( 200 * 1000 );
+      net.listener.receive( ack_with( synack->sender_message.seqno + 1 ) );
+      expect( net.servers.size() == 0, "a stale cookie was accepted" );
+    }
+
+    // While the accept queue is full, new SYNs are dropped, and completed handshakes wait for room
+    {
+      TCPConfig cfg;
+      cfg.accept_backlog = 2;
+      Network net { cfg };
+      for ( uint16_t i = 0; i < 3; i++ ) {
+        net.connect( 6000 + i );
+      }
+      net.exchange();
+      expect( net.listener.accept_queue_size() == 2, "accept queue exceeded its backlog" );
+      expect( net.listener.syn_queue_size() == 1, "third connection should wait in the SYN queue" );
+
+      net.connect( 6003 );
+      net.exchange();
+      expect( net.listener.syns_dropped() == 1, "expected the fourth SYN to be dropped" );
+
+      int accepted = 0;
+      while ( net.listener.accept().has_value() ) {
+        accepted++;
+      }
+      expect( accepted == 3, "expected the waiting connection to be accepted after the first two" );
+    }
+
+    // Fast Open: the first connection earns a cookie, and the next one's request rides on its SYN and is
+    // answered within the first round trip
+    {
+      TCPConfig cfg;
+      cfg.fast_open = true;
+      Network net { cfg };
+      TCPConfig client_cfg;
+      client_cfg.fast_open = true;
+
+      auto request_response = [&]( uint16_t client_port ) {
+        const auto client = net.clients.connect(
+          { CLIENT_IP, SERVER_IP, client_port, SERVER_PORT }, client_cfg, "request " + to_string( client_port ) );
+
+        // one round trip: the SYN goes out, and the server answers whatever it has been able to read
+        net.clients.collect( net.to_server );
+        for ( const auto& dgram : net.to_server ) {
+          net.listener.receive( dgram );
+        }
+        net.to_server.clear();
+        const auto server = net.listener.accept();
+        if ( server.has_value() ) {
+          auto& in = net.servers.peer( server.value() ).inbound_reader();
+          if ( in.peek() == "request " + to_string( client_port ) ) {
+            net.servers.peer( server.value() ).outbound_writer().push( "response" );
+          }
+          in.pop( in.bytes_buffered() );
+        }
+        net.servers.collect( net.to_client );
+        net.clients.receive( net.to_client );
+        net.to_client.clear();
+
+        const bool answered = net.clients.peer( client ).inbound_reader().peek() == "response";
+        net.exchange();
+        return answered;
+      };
+
+      expect( not request_response( 3000 ), "first connection cannot have been answered in one round trip" );
+      expect( net.clients.fast_open_cache().size() == 1, "client did not cache the server's cookie" );
+      expect( request_response( 3001 ), "second connection was not answered in one round trip" );
+      expect( net.listener.fast_opens() == 1, "expected one Fast Open connection" );
+    }
+
+    // A SYN with a bad cookie has its data dropped, and the client sends it again after the handshake
+    {
+      TCPConfig cfg;
+      cfg.fast_open = true;
+      Network net { cfg };
+      TCPConfig client_cfg;
+      client_cfg.fast_open = true;
+      const auto client = net.clients.add( { CLIENT_IP, SERVER_IP, 3100, SERVER_PORT }, client_cfg );
+      TCPOptions::FastOpenCookie forged;
+      forged.length = 8;
+      net.clients.peer( client ).fast_open( forged, 1460 );
+      net.clients.peer( client ).outbound_writer().push( "early data" );
+      net.clients.peer( client ).push();
+      net.clients.mark_ready( client );
+      net.exchange();
+
+      const auto server = net.listener.accept();
+      expect( server.has_value() and net.listener.fast_opens() == 0, "a forged cookie was honored" );
+      expect( net.servers.peer( server.value() ).inbound_reader().peek() == "early data",
+              "data from a rejected Fast Open SYN was not sent again" );
+      expect( net.clients.fast_open_cache().size() == 1, "client did not take the cookie granted instead" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
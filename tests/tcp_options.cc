@@ -0,0 +1,162 @@
+#include "parser.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static constexpr uint32_t PSEUDO_CHECKSUM = 0x1234;
+
+TCPSegment roundtrip( TCPSegment seg )
+{
+  seg.compute_checksum( PSEUDO_CHECKSUM );
+  const vector<Buffer> wire = serialize( seg );
+
+  size_t total = 0;
+  for ( const auto& b : wire ) {
+    total += b.size();
+  }
+  if ( total != seg.header_length() + seg.sender_message.payload.size() ) {
+    throw runtime_error( "serialized length disagrees with header_length()" );
+  }
+  if ( seg.header_length() % 4 ) {
+    throw runtime_error( "header is not padded to a multiple of four bytes" );
+  }
+
+  TCPSegment out;
+  if ( not parse( out, wire, PSEUDO_CHECKSUM ) ) {
+    throw runtime_error( "segment with options failed to parse (or checksum did not cover them)" );
+  }
+  if ( string_view( out.sender_message.payload ) != string_view( seg.sender_message.payload ) ) {
+    throw runtime_error( "payload changed across roundtrip" );
+  }
+  return out;
+}
+
+void expect( bool cond, const string& what )
+{
+  if ( not cond ) {
+    throw runtime_error( what );
+  }
+}
+
+int main()
+{
+  try {
+    // plain header
+    {
+      TCPSegment seg;
+      seg.sender_message.payload = string( "hello" );
+      const auto out = roundtrip( seg );
+      expect( seg.header_length() == TCPSegment::MIN_HEADER_LENGTH, "plain header should be 20 bytes" );
+      expect( not out.options.mss and not out.options.timestamps and not out.options.window_scale,
+              "plain header grew options" );
+    }
+
+    // a typical SYN: everything but SACK blocks
+    {
+      TCPSegment seg;
+      seg.sender_message.SYN = true;
+      seg.options.mss = 1460;
+      seg.options.sack_permitted = true;
+      seg.options.timestamps = TCPOptions::Timestamps { 0xdeadbeef, 7 };
+      seg.options.window_scale = 7;
+      const auto out = roundtrip( seg );
+      expect( seg.header_length() == 40, "SYN options should take 20 bytes" );
+      expect( out.options.mss == 1460, "MSS lost" );
+      expect( out.options.sack_permitted, "SACK-permitted lost" );
+      expect( out.options.timestamps->tsval == 0xdeadbeef and out.options.timestamps->tsecr == 7,
+              "timestamps lost" );
+      expect( out.options.window_scale == 7, "window scale lost" );
+    }
+
+    // SACK blocks are trimmed to what fits beside the timestamps
+    {
+      TCPSegment seg;
+      seg.options.timestamps = TCPOptions::Timestamps { 1, 2 };
+      seg.options.sack_block_count = 4;
+      for ( uint32_t i = 0; i < 4; i++ ) {
+        seg.options.sack_blocks.at( i ) = { Wrap32 { 1000 * i }, Wrap32 { 1000 * i + 500 } };
+      }
+      const auto out = roundtrip( seg );
+      expect( seg.header_length() == 60, "timestamps plus three SACK blocks should fill the option space" );
+      expect( out.options.sack_block_count == 3, "expected three SACK blocks to survive" );
+      expect( out.options.sack_blocks.at( 2 ).left == Wrap32 { 2000 }
+                and out.options.sack_blocks.at( 2 ).right == Wrap32 { 2500 },
+              "SACK block contents changed" );
+    }
+
+    // unknown options pass through verbatim, with odd lengths padded
+    {
+      TCPSegment seg;
+      seg.options.mss = 536;
+      const uint8_t unknown[] = { 30, 5, 0xaa, 0xbb, 0xcc }; // e.g. MPTCP with an odd length
+      copy( begin( unknown ), end( unknown ), seg.options.unknown.begin() );
+      seg.options.unknown_length = sizeof( unknown );
+      const auto out = roundtrip( seg );
+      expect( seg.header_length() == 32, "unknown option should be padded to eight bytes" );
+      expect( out.options.mss == 536, "MSS lost next to unknown option" );
+      expect( out.options.unknown_length == sizeof( unknown )
+                and equal( begin( unknown ), end( unknown ), out.options.unknown.begin() ),
+              "unknown option not passed through" );
+    }
+
+    // Fast Open: a cookie request, and a cookie beside every other SYN option
+    {
+      TCPSegment seg;
+      seg.sender_message.SYN = true;
+      seg.options.fast_open = TCPOptions::FastOpenCookie {};
+      auto out = roundtrip( seg );
+      expect( seg.header_length() == 24, "a Fast Open cookie request should take four bytes" );
+      expect( out.options.fast_open.has_value() and out.options.fast_open->length == 0, "cookie request lost" );
+
+      seg.options.mss = 1460;
+      seg.options.sack_permitted = true;
+      seg.options.timestamps = TCPOptions::Timestamps { 5, 0 };
+      seg.options.window_scale = 7;
+      seg.options.fast_open->length = 16;
+      for ( uint8_t i = 0; i < 16; i++ ) {
+        seg.options.fast_open->bytes.at( i ) = 0xa0 + i;
+      }
+      seg.sender_message.payload = string( "GET / HTTP/1.0" );
+      out = roundtrip( seg );
+      expect( seg.header_length() == 60, "a 16-byte cookie should fill the option space of a full SYN" );
+      expect( out.options.fast_open == seg.options.fast_open, "Fast Open cookie changed" );
+      expect( out.options.window_scale == 7 and out.options.mss == 1460, "options next to the cookie lost" );
+    }
+
+    // ECN flags share the header with the options
+    {
+      TCPSegment seg;
+      seg.ece = true;
+      seg.options.mss = 1460;
+      auto out = roundtrip( seg );
+      expect( out.ece and not out.cwr and out.options.mss == 1460, "ECE flag lost" );
+      seg.ece = false;
+      seg.cwr = true;
+      out = roundtrip( seg );
+      expect( out.cwr and not out.ece, "CWR flag lost" );
+    }
+
+    // malformed option: everything before it is kept, the segment still parses
+    {
+      TCPSegment seg;
+      seg.options.mss = 1200;
+      const uint8_t bad[] = { 99, 40 }; // length runs past the option space
+      copy( begin( bad ), end( bad ), seg.options.unknown.begin() );
+      seg.options.unknown_length = sizeof( bad );
+      const auto out = roundtrip( seg );
+      expect( out.options.mss == 1200, "MSS before a malformed option lost" );
+      expect( out.options.unknown_length == 0, "malformed option should be dropped" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,84 @@
+#include "parser.hh"
+#include "tcp_segment.hh"
+
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+static constexpr uint32_t PSEUDO_CHECKSUM = 0x1234;
+
+// Parse the same serialized segment `rounds` times; returns nanoseconds per parse
+double time_parse( const vector<Buffer>& wire, const size_t rounds )
+{
+  size_t check = 0;
+  const auto start_time = steady_clock::now();
+  for ( size_t i = 0; i < rounds; i++ ) {
+    TCPSegment seg;
+    if ( not parse( seg, wire, PSEUDO_CHECKSUM ) ) {
+      throw runtime_error( "benchmark segment failed to parse" );
+    }
+    check += seg.options.timestamps.has_value();
+  }
+  const auto stop_time = steady_clock::now();
+  if ( check != 0 and check != rounds ) {
+    throw runtime_error( "inconsistent parse results" );
+  }
+  return static_cast<double>( duration_cast<nanoseconds>( stop_time - start_time ).count() )
+         / static_cast<double>( rounds );
+}
+
+// A header-only segment, so that the checksum and copy of a payload do not drown out the options
+vector<Buffer> make_wire( bool with_options )
+{
+  TCPSegment seg;
+  seg.sender_message.seqno = Wrap32 { 12345 };
+  seg.receiver_message.ackno = Wrap32 { 67890 };
+  seg.receiver_message.window_size = 30000;
+  if ( with_options ) {
+    // what a data segment on a SACK- and timestamps-enabled connection typically carries
+    seg.options.timestamps = TCPOptions::Timestamps { 1000, 999 };
+    seg.options.sack_block_count = 1;
+    seg.options.sack_blocks.at( 0 ) = { Wrap32 { 20000 }, Wrap32 { 21400 } };
+  }
+  seg.compute_checksum( PSEUDO_CHECKSUM );
+  return serialize( seg );
+}
+
+int main()
+{
+  try {
+    constexpr size_t rounds = 20000;
+    constexpr size_t runs = 50;
+    const auto plain = make_wire( false );
+    const auto with_options = make_wire( true );
+
+    // Alternate short runs of each, and keep the fastest of each: a run the scheduler interrupts does
+    // not count, and a slow stretch of the machine slows both alike
+    time_parse( plain, rounds ); // warm up
+    double plain_ns = time_parse( plain, rounds );
+    double options_ns = time_parse( with_options, rounds );
+    for ( size_t run = 1; run < runs; run++ ) {
+      plain_ns = min( plain_ns, time_parse( plain, rounds ) );
+      options_ns = min( options_ns, time_parse( with_options, rounds ) );
+    }
+
+    cout << fixed << setprecision( 1 ) << "TCPSegment::parse: plain header " << plain_ns << " ns, with options "
+         << options_ns << " ns (" << setprecision( 2 ) << options_ns / plain_ns << "x).\n";
+
+    if ( options_ns > 1.5 * plain_ns ) {
+      throw runtime_error( "parsing TCP options costs far more than parsing a plain header" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include "tcp_peer.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+void expect( bool cond, const string& what )
+{
+  if ( not cond ) {
+    throw runtime_error( what );
+  }
+}
+
+// Deliver everything `from` has to send to `to`, `delay_ms` later
+void carry( TCPPeer& from, TCPPeer& to, uint64_t delay_ms )
+{
+  vector<TCPSegment> in_flight;
+  while ( auto seg = from.maybe_send() ) {
+    in_flight.push_back( move( seg.value() ) );
+  }
+  from.tick( delay_ms );
+  to.tick( delay_ms );
+  for ( auto& seg : in_flight ) {
+    to.receive( move( seg ) );
+  }
+}
+
+int main()
+{
+  try {
+    // a sends as fast as b's window allows, over a 20 ms RTT, and b's application reads everything at once
+    TCPConfig cfg;
+    cfg.recv_capacity = 16 * 1024;
+    cfg.recv_capacity_max = 256 * 1024;
+    cfg.send_capacity = 1024 * 1024;
+    TCPPeer a { cfg };
+    TCPPeer b { cfg };
+
+    a.push();
+    uint64_t largest = b.recv_capacity();
+    uint64_t read = 0;
+    for ( int round = 0; round < 50; round++ ) {
+      a.outbound_writer().push( string( a.outbound_writer().available_capacity(), 'x' ) );
+      carry( a, b, 10 );
+      read += b.inbound_reader().bytes_buffered();
+      b.inbound_reader().pop( b.inbound_reader().bytes_buffered() );
+      carry( b, a, 10 );
+
+      expect( b.recv_capacity() <= cfg.recv_capacity_max, "autotuning grew past recv_capacity_max" );
+      largest = max( largest, b.recv_capacity() );
+    }
+
+    expect( read > 0, "no data got through" );
+    expect( largest == cfg.recv_capacity_max, "autotuning did not grow to recv_capacity_max while drained at line "
+                                                "rate: largest capacity was "
+                                                + to_string( largest ) );
+    expect( b.recv_capacity() == cfg.recv_capacity_max, "autotuning did not stay at recv_capacity_max" );
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
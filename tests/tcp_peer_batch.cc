@@ -0,0 +1,50 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = false;
+
+      TCPPeerTestHarness test { "Segments of a batch share one up-to-date ACK and window", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 5000 ).with_mss( 1000 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_seqno( isn ).with_ackno( peer_isn + 1 ) );
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 5000 ) );
+      test.execute( Write { string( 10000, 'x' ) } );
+      test.execute( ExpectBatch { 0, 0, peer_isn + 1, 0 } );
+      test.execute( ExpectBatch { 3, 3, peer_isn + 1, 1000 } );
+
+      // data arriving between batches is acknowledged by every segment of the next one
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 5000 ).with_data(
+        "hello" ) );
+      test.execute( ExpectBatch { 64, 2, peer_isn + 6, 1000 } );
+      test.execute( ExpectNoSegment {} );
+
+      // the window, not max_count, ends this batch
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 6 ).with_ackno( isn + 3001 ).with_win( 5000 ) );
+      test.execute( ExpectBatch { 2, 2, peer_isn + 6, 1000 } );
+      test.execute( ExpectBatch { 64, 1, peer_isn + 6, 1000 } );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
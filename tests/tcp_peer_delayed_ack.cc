@@ -0,0 +1,128 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// Open a connection passively, with a peer whose MSS is the default one, without timestamps (so that full
+// segments carry exactly TCPConfig::DEFAULT_MSS bytes)
+void handshake( TCPPeerTestHarness& test, Wrap32 isn, Wrap32 peer_isn )
+{
+  test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 65535 ).with_mss( 1460 ) );
+  test.execute( ExpectSegment {}.with_syn( true ).with_seqno( isn ).with_ackno( peer_isn + 1 ) );
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    constexpr size_t mss = TCPConfig::DEFAULT_MSS;
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.timestamps = false;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "Every second full-sized segment is acknowledged at once", cfg };
+      handshake( test, isn, peer_isn );
+      test.execute( SegmentArrives {}.with_seqno( start ).with_ackno( isn + 1 ).with_data( string( mss, 'a' ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + mss ).with_ackno( isn + 1 ).with_data( string( mss, 'b' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 2 * mss ).with_payload_size( 0 ) );
+      test.execute( ExpectNoSegment {} );
+
+      // the count starts over after each ACK
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 2 * mss ).with_ackno( isn + 1 ).with_data( string( mss, 'c' ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 3 * mss ).with_ackno( isn + 1 ).with_data( string( mss, 'd' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 4 * mss ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.timestamps = false;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "A lone segment is acknowledged when the 40 ms timer fires", cfg };
+      handshake( test, isn, peer_isn );
+      test.execute( SegmentArrives {}.with_seqno( start ).with_ackno( isn + 1 ).with_data( string( 100, 'a' ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 20 } );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 100 ).with_ackno( isn + 1 ).with_data( string( 100, 'b' ) ) );
+      test.execute( Tick { 19 } );
+      test.execute( ExpectNoSegment {} );
+
+      // the timer runs from the first segment held back, not the last
+      test.execute( Tick { 1 } );
+      test.execute( ExpectSegment {}.with_ackno( start + 200 ).with_payload_size( 0 ) );
+      test.execute( Tick { 40 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.timestamps = false;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "Out-of-order data, a segment filling the hole, and FIN are ACKed at once", cfg };
+      handshake( test, isn, peer_isn );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 100 ).with_ackno( isn + 1 ).with_data( string( 100, 'b' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start ) );
+      test.execute( SegmentArrives {}.with_seqno( start ).with_ackno( isn + 1 ).with_data( string( 100, 'a' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 200 ) );
+      test.execute( SegmentArrives {}.with_seqno( start + 200 ).with_ackno( isn + 1 ).with_fin() );
+      test.execute( ExpectSegment {}.with_ackno( start + 201 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.timestamps = false;
+      cfg.window_scaling = false;
+      cfg.recv_autotune = false;
+      cfg.recv_capacity = 3 * mss;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "A held-back ACK goes out at once when the application reopens the window", cfg };
+      handshake( test, isn, peer_isn );
+      test.execute( SegmentArrives {}.with_seqno( start ).with_ackno( isn + 1 ).with_data( string( mss, 'a' ) ) );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + mss ).with_ackno( isn + 1 ).with_data( string( mss, 'b' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 2 * mss ).with_win( mss ) );
+
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 2 * mss ).with_ackno( isn + 1 ).with_data( string( 500, 'c' ) ) );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Read { 2 * mss } );
+      test.execute( ExpectSegment {}.with_ackno( start + 2 * mss + 500 ).with_win( 3 * mss - 500 ) );
+      test.execute( Tick { 40 } );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
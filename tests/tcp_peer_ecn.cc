@@ -0,0 +1,68 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.timestamps = false;
+
+      TCPPeerTestHarness test { "Retransmissions are Not-ECT, and CWR goes on the next new data", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 65535 )
+                      .with_mss( 1460 )
+                      .with_ece()
+                      .with_cwr() );
+      test.execute( ExpectSegment {}.with_syn( true ).with_ecn( IPv4Header::ECN_NOT_ECT ) );
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 65535 ) );
+
+      test.execute( Write { string( 2000, 'x' ) } );
+      test.execute(
+        ExpectSegment {}.with_seqno( isn + 1 ).with_payload_size( 1460 ).with_ecn( IPv4Header::ECN_ECT0 ) );
+      test.execute(
+        ExpectSegment {}.with_seqno( isn + 1461 ).with_payload_size( 540 ).with_ecn( IPv4Header::ECN_ECT0 ) );
+
+      // the ECE shrinks the congestion window, so the next new data segment owes the peer a CWR...
+      test.execute(
+        SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1461 ).with_win( 65535 ).with_ece() );
+      test.execute( ExpectNoSegment {} );
+
+      // ...but a retransmission is neither ECN-capable nor the place for it (RFC 3168 6.1.5)
+      test.execute( Tick { cfg.rt_timeout } );
+      test.execute( ExpectSegment {}
+                      .with_seqno( isn + 1461 )
+                      .with_payload_size( 540 )
+                      .with_ecn( IPv4Header::ECN_NOT_ECT )
+                      .with_cwr( false ) );
+
+      test.execute( Write { string( 100, 'y' ) } );
+      test.execute( ExpectSegment {}
+                      .with_seqno( isn + 2001 )
+                      .with_payload_size( 100 )
+                      .with_ecn( IPv4Header::ECN_ECT0 )
+                      .with_cwr( true ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include "random.hh"
+#include "tcp_minnow_socket.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.mss = 1000;
+
+      TCPPeerTestHarness test { "Our smaller MSS wins, less the bytes of the timestamps option", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 5000 )
+                      .with_timestamps( 100, 0 )
+                      .with_mss( 1460 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_mss( 1000 ) );
+      test.execute( ExpectMaxPayload { 1000 - TCPOptions::TIMESTAMPS_LENGTH } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = false;
+
+      TCPPeerTestHarness test { "The peer's smaller MSS bounds the segments we send", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 5000 ).with_mss( 700 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_mss( TCPConfig::DEFAULT_MSS ) );
+      test.execute( ExpectMaxPayload { 700 } );
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 5000 ) );
+      test.execute( Write { string( 1500, 'x' ) } );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1 ).with_payload_size( 700 ).with_mss( nullopt ) );
+      test.execute( ExpectSegment {}.with_seqno( isn + 701 ).with_payload_size( 700 ) );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1401 ).with_payload_size( 100 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPPeerTestHarness test { "A SYN without an MSS option means the RFC 9293 default of 536", cfg };
+      test.execute(
+        SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 5000 ).with_timestamps( 100, 0 ) );
+      test.execute( ExpectSegment {}.with_syn( true ) );
+      test.execute( ExpectMaxPayload { TCPConfig::DEFAULT_PEER_MSS - TCPOptions::TIMESTAMPS_LENGTH } );
+    }
+
+    for ( const uint16_t tiny : { 0, 4 } ) {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.congestion_control = false;
+
+      TCPPeerTestHarness test { "A peer MSS of " + to_string( tiny ) + " is raised to the floor", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 5000 )
+                      .with_timestamps( 100, 0 )
+                      .with_mss( tiny ) );
+      test.execute( ExpectSegment {}.with_syn( true ) );
+      constexpr size_t payload = TCPConfig::MIN_PEER_MSS - TCPOptions::TIMESTAMPS_LENGTH;
+      test.execute( ExpectMaxPayload { payload } );
+      test.execute( SegmentArrives {}
+                      .with_seqno( peer_isn + 1 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 101, 1 ) );
+      test.execute( Write { string( 200, 'x' ) } );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1 ).with_payload_size( payload ) );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1 + payload ).with_payload_size( payload ) );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1 + 2 * payload ).with_payload_size( 200 - 2 * payload ) );
+    }
+
+    {
+      TCPConfig cfg;
+      FdAdapterConfig adapter;
+      if ( fit_to_mtu( cfg, adapter ).mss != TCPConfig::DEFAULT_MSS ) {
+        throw runtime_error( "fit_to_mtu() changed the MSS for a standard MTU" );
+      }
+      adapter.mtu = EthernetHeader::MAX_MTU;
+      if ( fit_to_mtu( cfg, adapter ).mss != TCPConfig::DEFAULT_MSS ) {
+        throw runtime_error( "fit_to_mtu() raised the MSS for jumbo frames" );
+      }
+
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      adapter.mtu = 576;
+
+      TCPPeerTestHarness test { "Over a 576-byte MTU the MSS is clamped to 536", fit_to_mtu( cfg, adapter ) };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 5000 ).with_mss( 1460 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_mss( 536 ) );
+      test.execute( ExpectMaxPayload { 536 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,447 @@
+#pragma once
+
+#include "common.hh"
+#include "tcp_config.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static std::string to_string( const TCPSegment& seg )
+{
+  std::ostringstream o;
+  o << "(seqno=" << seg.sender_message.seqno;
+  if ( seg.sender_message.SYN ) {
+    o << " +SYN";
+  }
+  if ( seg.receiver_message.ackno.has_value() ) {
+    o << " ackno=" << seg.receiver_message.ackno.value();
+  }
+  o << " win=" << seg.receiver_message.window_size;
+  if ( not seg.sender_message.payload.empty() ) {
+    o << " payload_len=" << seg.sender_message.payload.size();
+  }
+  if ( seg.sender_message.FIN ) {
+    o << " +FIN";
+  }
+  if ( seg.options.timestamps.has_value() ) {
+    o << " TSval=" << seg.options.timestamps->tsval << " TSecr=" << seg.options.timestamps->tsecr;
+  }
+  if ( seg.options.window_scale.has_value() ) {
+    o << " WS=" << static_cast<int>( seg.options.window_scale.value() );
+  }
+  if ( seg.options.mss.has_value() ) {
+    o << " MSS=" << seg.options.mss.value();
+  }
+  if ( seg.ece ) {
+    o << " +ECE";
+  }
+  if ( seg.cwr ) {
+    o << " +CWR";
+  }
+  o << ")";
+  return o.str();
+}
+
+// A segment from the remote end arrives. Its window is the value on the wire (scaled, after the SYN).
+struct SegmentArrives : public Action<TCPPeer>
+{
+  TCPSegment seg_ {};
+
+  SegmentArrives& with_syn()
+  {
+    seg_.sender_message.SYN = true;
+    return *this;
+  }
+
+  SegmentArrives& with_fin()
+  {
+    seg_.sender_message.FIN = true;
+    return *this;
+  }
+
+  SegmentArrives& with_seqno( Wrap32 seqno )
+  {
+    seg_.sender_message.seqno = seqno;
+    return *this;
+  }
+
+  SegmentArrives& with_ackno( Wrap32 ackno )
+  {
+    seg_.receiver_message.ackno = ackno;
+    return *this;
+  }
+
+  SegmentArrives& with_win( uint32_t win )
+  {
+    seg_.receiver_message.window_size = win;
+    return *this;
+  }
+
+  SegmentArrives& with_data( std::string data )
+  {
+    seg_.sender_message.payload = std::move( data );
+    return *this;
+  }
+
+  SegmentArrives& with_timestamps( uint32_t tsval, uint32_t tsecr )
+  {
+    seg_.options.timestamps = TCPOptions::Timestamps { tsval, tsecr };
+    return *this;
+  }
+
+  SegmentArrives& with_window_scale( uint8_t shift )
+  {
+    seg_.options.window_scale = shift;
+    return *this;
+  }
+
+  SegmentArrives& with_mss( uint16_t mss )
+  {
+    seg_.options.mss = mss;
+    return *this;
+  }
+
+  SegmentArrives& with_ece()
+  {
+    seg_.ece = true;
+    return *this;
+  }
+
+  SegmentArrives& with_cwr()
+  {
+    seg_.cwr = true;
+    return *this;
+  }
+
+  std::string description() const override { return "segment arrives " + to_string( seg_ ); }
+  void execute( TCPPeer& peer ) const override { peer.receive( seg_ ); }
+};
+
+struct Tick : public Action<TCPPeer>
+{
+  uint64_t ms_;
+
+  explicit Tick( uint64_t ms ) : ms_( ms ) {}
+  std::string description() const override { return std::to_string( ms_ ) + " ms pass"; }
+  void execute( TCPPeer& peer ) const override { peer.tick( ms_ ); }
+};
+
+// The application writes to the outbound stream (which the next maybe_send() pushes to the sender)
+struct Write : public Action<TCPPeer>
+{
+  std::string data_;
+
+  explicit Write( std::string data ) : data_( std::move( data ) ) {}
+  std::string description() const override { return "write \"" + Printer::prettify( data_ ) + "\""; }
+  void execute( TCPPeer& peer ) const override { peer.outbound_writer().push( data_ ); }
+};
+
+// The application reads from the inbound stream
+struct Read : public Action<TCPPeer>
+{
+  uint64_t len_;
+
+  explicit Read( uint64_t len ) : len_( len ) {}
+  std::string description() const override { return "read " + std::to_string( len_ ) + " bytes"; }
+  void execute( TCPPeer& peer ) const override
+  {
+    if ( peer.inbound_reader().bytes_buffered() < len_ ) {
+      throw ExpectationViolation( "only " + std::to_string( peer.inbound_reader().bytes_buffered() )
+                                  + " bytes buffered to read" );
+    }
+    peer.inbound_reader().pop( len_ );
+  }
+};
+
+struct ExpectNoSegment : public Expectation<TCPPeer>
+{
+  std::string description() const override { return "nothing to send"; }
+  void execute( TCPPeer& peer ) const override
+  {
+    const auto seg = peer.maybe_send();
+    if ( seg.has_value() ) {
+      throw ExpectationViolation( "TCPPeer sent an unexpected segment: " + to_string( seg.value() ) );
+    }
+  }
+};
+
+// maybe_send() returns a segment with the given properties. Its window is the value on the wire.
+struct ExpectSegment : public Expectation<TCPPeer>
+{
+  std::optional<bool> syn {};
+  std::optional<bool> fin {};
+  std::optional<Wrap32> seqno {};
+  std::optional<Wrap32> ackno {};
+  std::optional<uint32_t> win {};
+  std::optional<size_t> payload_size {};
+  std::optional<uint32_t> tsval {};
+  std::optional<uint32_t> tsecr {};
+  std::optional<std::optional<uint8_t>> window_scale {};
+  std::optional<std::optional<uint16_t>> mss {};
+  std::optional<uint8_t> ecn {};
+  std::optional<bool> cwr {};
+
+  ExpectSegment& with_syn( bool syn_ )
+  {
+    syn = syn_;
+    return *this;
+  }
+
+  ExpectSegment& with_fin( bool fin_ )
+  {
+    fin = fin_;
+    return *this;
+  }
+
+  ExpectSegment& with_seqno( Wrap32 seqno_ )
+  {
+    seqno = seqno_;
+    return *this;
+  }
+
+  ExpectSegment& with_ackno( Wrap32 ackno_ )
+  {
+    ackno = ackno_;
+    return *this;
+  }
+
+  ExpectSegment& with_win( uint32_t win_ )
+  {
+    win = win_;
+    return *this;
+  }
+
+  ExpectSegment& with_payload_size( size_t payload_size_ )
+  {
+    payload_size = payload_size_;
+    return *this;
+  }
+
+  ExpectSegment& with_tsval( uint32_t tsval_ )
+  {
+    tsval = tsval_;
+    return *this;
+  }
+
+  ExpectSegment& with_tsecr( uint32_t tsecr_ )
+  {
+    tsecr = tsecr_;
+    return *this;
+  }
+
+  ExpectSegment& with_window_scale( std::optional<uint8_t> window_scale_ )
+  {
+    window_scale = window_scale_;
+    return *this;
+  }
+
+  ExpectSegment& with_mss( std::optional<uint16_t> mss_ )
+  {
+    mss = mss_;
+    return *this;
+  }
+
+  ExpectSegment& with_ecn( uint8_t ecn_ )
+  {
+    ecn = ecn_;
+    return *this;
+  }
+
+  ExpectSegment& with_cwr( bool cwr_ )
+  {
+    cwr = cwr_;
+    return *this;
+  }
+
+  std::string description() const override
+  {
+    std::ostringstream o;
+    o << "segment sent with";
+    if ( syn.has_value() ) {
+      o << ( syn.value() ? " +SYN" : " (no SYN)" );
+    }
+    if ( seqno.has_value() ) {
+      o << " seqno=" << seqno.value();
+    }
+    if ( ackno.has_value() ) {
+      o << " ackno=" << ackno.value();
+    }
+    if ( win.has_value() ) {
+      o << " win=" << win.value();
+    }
+    if ( payload_size.has_value() ) {
+      o << " payload_len=" << payload_size.value();
+    }
+    if ( fin.has_value() ) {
+      o << ( fin.value() ? " +FIN" : " (no FIN)" );
+    }
+    if ( tsval.has_value() ) {
+      o << " TSval=" << tsval.value();
+    }
+    if ( tsecr.has_value() ) {
+      o << " TSecr=" << tsecr.value();
+    }
+    if ( window_scale.has_value() ) {
+      o << ( window_scale->has_value() ? " WS=" + std::to_string( window_scale->value() ) : " (no WS)" );
+    }
+    if ( mss.has_value() ) {
+      o << ( mss->has_value() ? " MSS=" + std::to_string( mss->value() ) : " (no MSS)" );
+    }
+    if ( ecn.has_value() ) {
+      o << " ECN=" << static_cast<unsigned>( ecn.value() );
+    }
+    if ( cwr.has_value() ) {
+      o << ( cwr.value() ? " +CWR" : " (no CWR)" );
+    }
+    return o.str();
+  }
+
+  void execute( TCPPeer& peer ) const override
+  {
+    const auto maybe_seg = peer.maybe_send();
+    if ( not maybe_seg.has_value() ) {
+      throw ExpectationViolation( "expected a segment, but none was sent" );
+    }
+    const TCPSegment& seg = maybe_seg.value();
+    const auto& ts = seg.options.timestamps;
+
+    if ( syn.has_value() and seg.sender_message.SYN != syn.value() ) {
+      throw ExpectationViolation( "SYN flag", syn.value(), seg.sender_message.SYN );
+    }
+    if ( fin.has_value() and seg.sender_message.FIN != fin.value() ) {
+      throw ExpectationViolation( "FIN flag", fin.value(), seg.sender_message.FIN );
+    }
+    if ( seqno.has_value() and seg.sender_message.seqno != seqno.value() ) {
+      throw ExpectationViolation( "sequence number", seqno.value(), seg.sender_message.seqno );
+    }
+    if ( ackno.has_value() and seg.receiver_message.ackno != ackno ) {
+      throw ExpectationViolation( "ackno", ackno, seg.receiver_message.ackno );
+    }
+    if ( win.has_value() and seg.receiver_message.window_size != win.value() ) {
+      throw ExpectationViolation( "window", win.value(), seg.receiver_message.window_size );
+    }
+    if ( payload_size.has_value() and seg.sender_message.payload.size() != payload_size.value() ) {
+      throw ExpectationViolation( "payload_size", payload_size.value(), seg.sender_message.payload.size() );
+    }
+    if ( ( tsval.has_value() or tsecr.has_value() ) and not ts.has_value() ) {
+      throw ExpectationViolation( "expected a timestamps option, but the segment has none" );
+    }
+    if ( tsval.has_value() and ts->tsval != tsval.value() ) {
+      throw ExpectationViolation( "TSval", tsval.value(), ts->tsval );
+    }
+    if ( tsecr.has_value() and ts->tsecr != tsecr.value() ) {
+      throw ExpectationViolation( "TSecr", tsecr.value(), ts->tsecr );
+    }
+    if ( window_scale.has_value() and seg.options.window_scale != window_scale.value() ) {
+      throw ExpectationViolation( "window scale option", window_scale.value(), seg.options.window_scale );
+    }
+    if ( mss.has_value() and seg.options.mss != mss.value() ) {
+      throw ExpectationViolation( "MSS option", mss.value(), seg.options.mss );
+    }
+    if ( ecn.has_value() and seg.ecn != ecn.value() ) {
+      throw ExpectationViolation(
+        "ECN codepoint", static_cast<unsigned>( ecn.value() ), static_cast<unsigned>( seg.ecn ) );
+    }
+    if ( cwr.has_value() and seg.cwr != cwr.value() ) {
+      throw ExpectationViolation( "CWR flag", cwr.value(), seg.cwr );
+    }
+  }
+};
+
+// The batched maybe_send() appends `count` segments (asked for at most `max_count`), all of them
+// acknowledging `ackno` with the same window, and each carrying `payload_size` bytes
+struct ExpectBatch : public Expectation<TCPPeer>
+{
+  size_t max_count_;
+  size_t count_;
+  Wrap32 ackno_;
+  size_t payload_size_;
+
+  ExpectBatch( size_t max_count, size_t count, Wrap32 ackno, size_t payload_size )
+    : max_count_( max_count ), count_( count ), ackno_( ackno ), payload_size_( payload_size )
+  {}
+
+  std::string description() const override
+  {
+    std::ostringstream o;
+    o << "batch of up to " << max_count_ << " has " << count_ << " segments of " << payload_size_
+      << " bytes, all with ackno=" << ackno_ << " and one window";
+    return o.str();
+  }
+
+  void execute( TCPPeer& peer ) const override
+  {
+    std::vector<TCPSegment> out { TCPSegment {} }; // appended to, not overwritten
+    const size_t added = peer.maybe_send( out, max_count_ );
+    if ( added != count_ or out.size() != count_ + 1 ) {
+      throw ExpectationViolation( "segments in the batch", count_, added );
+    }
+    for ( size_t i = 1; i < out.size(); i++ ) {
+      const auto& seg = out[i];
+      if ( seg.receiver_message.ackno != std::optional { ackno_ } ) {
+        throw ExpectationViolation( "ackno of segment " + std::to_string( i - 1 ),
+                                    std::optional { ackno_ },
+                                    seg.receiver_message.ackno );
+      }
+      if ( seg.receiver_message.window_size != out[1].receiver_message.window_size ) {
+        throw ExpectationViolation( "segments of one batch carry different windows" );
+      }
+      if ( seg.sender_message.payload.size() != payload_size_ ) {
+        throw ExpectationViolation( "payload_size", payload_size_, seg.sender_message.payload.size() );
+      }
+    }
+  }
+};
+
+struct ExpectPeerWindow : public ExpectNumber<TCPPeer, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "peer's window (unscaled)"; }
+  uint64_t value( TCPPeer& peer ) const override { return peer.sender().window(); }
+};
+
+struct ExpectMaxPayload : public ExpectNumber<TCPPeer, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "sender().max_payload_size()"; }
+  uint64_t value( TCPPeer& peer ) const override { return peer.sender().max_payload_size(); }
+};
+
+struct ExpectSrtt : public ExpectNumber<TCPPeer, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "sender().srtt_ms()"; }
+  uint64_t value( TCPPeer& peer ) const override { return peer.sender().srtt_ms().value_or( 0 ); }
+};
+
+struct ExpectTsRecent : public ExpectNumber<TCPPeer, uint32_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "receiver().ts_recent()"; }
+  uint32_t value( TCPPeer& peer ) const override { return peer.receiver().ts_recent().value_or( 0 ); }
+};
+
+struct ExpectBytesBuffered : public ExpectNumber<TCPPeer, uint64_t>
+{
+  using ExpectNumber::ExpectNumber;
+  std::string name() const override { return "inbound_reader().bytes_buffered()"; }
+  uint64_t value( TCPPeer& peer ) const override { return peer.inbound_reader().bytes_buffered(); }
+};
+
+class TCPPeerTestHarness : public TestHarness<TCPPeer>
+{
+public:
+  TCPPeerTestHarness( std::string name, const TCPConfig& config )
+    : TestHarness( std::move( name ),
+                   "recv_capacity=" + std::to_string( config.recv_capacity ) + ", mss="
+                     + std::to_string( config.mss ),
+                   TCPPeer { config } )
+  {}
+};
@@ -0,0 +1,149 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+
+      TCPPeerTestHarness test { "RTT samples are taken from the echoed TSecr", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 5000 )
+                      .with_timestamps( 100, 0 )
+                      .with_mss( 1460 ) );
+      test.execute(
+        ExpectSegment {}.with_syn( true ).with_ackno( peer_isn + 1 ).with_tsval( 1 ).with_tsecr( 100 ) );
+      test.execute( Tick { 30 } );
+      test.execute( SegmentArrives {}
+                      .with_seqno( peer_isn + 1 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 101, 1 ) );
+      test.execute( ExpectSrtt { 30 } );
+
+      test.execute( Write { string( 1000, 'x' ) } );
+      test.execute( ExpectSegment {}.with_seqno( isn + 1 ).with_payload_size( 1000 ).with_tsval( 31 ) );
+      test.execute( Tick { 70 } );
+      // the ACK echoes a later TSval than the segment's: the sample is 50 ms, not the 70 since it was sent
+      test.execute( SegmentArrives {}
+                      .with_seqno( peer_isn + 1 )
+                      .with_ackno( isn + 1001 )
+                      .with_win( 5000 )
+                      .with_timestamps( 150, 51 ) );
+      test.execute( ExpectSrtt { 32 } );
+      test.execute( ExpectNoSegment {} );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "TS.Recent moves only for segments at or before Last.ACK.sent", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 5000 )
+                      .with_timestamps( 100, 0 )
+                      .with_mss( 1460 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_ackno( start ).with_tsecr( 100 ) );
+      test.execute( ExpectTsRecent { 100 } );
+
+      // both segments are acknowledged by one delayed ACK, which must echo the first one's TSval
+      test.execute( SegmentArrives {}
+                      .with_seqno( start )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 120, 1 )
+                      .with_data( string( 100, 'a' ) ) );
+      test.execute( ExpectTsRecent { 120 } );
+      test.execute( SegmentArrives {}
+                      .with_seqno( start + 100 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 130, 1 )
+                      .with_data( string( 100, 'b' ) ) );
+      test.execute( ExpectTsRecent { 120 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Tick { 40 } );
+      test.execute( ExpectSegment {}.with_ackno( start + 200 ).with_tsecr( 120 ) );
+
+      // with that ACK sent, the next in-order segment updates TS.Recent
+      test.execute( SegmentArrives {}
+                      .with_seqno( start + 200 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 140, 1 )
+                      .with_data( string( 100, 'c' ) ) );
+      test.execute( ExpectTsRecent { 140 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "PAWS drops a segment with an old TSval, and acknowledges it at once", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 5000 )
+                      .with_timestamps( 100, 0 )
+                      .with_mss( 1460 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_ackno( start ) );
+      test.execute( SegmentArrives {}
+                      .with_seqno( start )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 120, 1 )
+                      .with_data( string( 100, 'a' ) ) );
+      test.execute( Tick { 40 } );
+      test.execute( ExpectSegment {}.with_ackno( start + 100 ).with_tsecr( 120 ) );
+
+      test.execute( SegmentArrives {}
+                      .with_seqno( start + 100 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 110, 1 )
+                      .with_data( string( 100, 'b' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 100 ).with_tsecr( 120 ) );
+      test.execute( ExpectBytesBuffered { 100 } );
+      test.execute( ExpectTsRecent { 120 } );
+
+      // the same data with a current TSval is accepted
+      test.execute( SegmentArrives {}
+                      .with_seqno( start + 100 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 5000 )
+                      .with_timestamps( 125, 1 )
+                      .with_data( string( 100, 'b' ) ) );
+      test.execute( ExpectBytesBuffered { 200 } );
+      test.execute( ExpectTsRecent { 125 } );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
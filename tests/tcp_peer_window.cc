@@ -0,0 +1,87 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+// A receiver whose buffer is three full segments, which ACKs every segment at once, so that the windows it
+// advertises follow only from silly window syndrome avoidance (the threshold is one MSS)
+TCPConfig small_buffer( Wrap32 isn )
+{
+  TCPConfig cfg;
+  cfg.fixed_isn = isn;
+  cfg.timestamps = false;
+  cfg.window_scaling = false;
+  cfg.recv_autotune = false;
+  cfg.delayed_ack_ms = 0;
+  cfg.recv_capacity = 3 * TCPConfig::DEFAULT_MSS;
+  return cfg;
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+    constexpr size_t mss = TCPConfig::DEFAULT_MSS;
+
+    {
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "The right edge of the window moves on by at least one MSS", small_buffer( isn ) };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 65535 ).with_mss( mss ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_ackno( start ).with_win( 3 * mss ) );
+
+      test.execute( SegmentArrives {}.with_seqno( start ).with_ackno( isn + 1 ).with_data( string( 1000, 'a' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 1000 ).with_win( 3 * mss - 1000 ) );
+
+      // reading 1000 bytes would move the edge by less than an MSS: no window update, and the next ACK
+      // still offers only what is left of the old window
+      test.execute( Read { 1000 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 1000 ).with_ackno( isn + 1 ).with_data( string( 500, 'b' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 1500 ).with_win( 3 * mss - 1500 ) );
+
+      // with 1500 bytes read, the edge moves on by one whole MSS (not 1500 bytes)
+      test.execute( Read { 500 } );
+      test.execute(
+        SegmentArrives {}.with_seqno( start + 1500 ).with_ackno( isn + 1 ).with_data( string( 10, 'c' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( start + 1510 ).with_win( 3 * mss - 1510 + mss ) );
+    }
+
+    {
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      const Wrap32 start = peer_isn + 1;
+
+      TCPPeerTestHarness test { "A window update goes out by itself once the window reopens", small_buffer( isn ) };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 65535 ).with_mss( mss ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_ackno( start ).with_win( 3 * mss ) );
+      for ( size_t i = 0; i < 3; i++ ) {
+        test.execute( SegmentArrives {}
+                        .with_seqno( start + i * mss )
+                        .with_ackno( isn + 1 )
+                        .with_data( string( mss, 'a' ) ) );
+        test.execute( ExpectSegment {}.with_ackno( start + ( i + 1 ) * mss ).with_win( ( 2 - i ) * mss ) );
+      }
+
+      test.execute( Read { 1000 } );
+      test.execute( ExpectNoSegment {} );
+      test.execute( Read { mss - 1000 } );
+      test.execute( ExpectSegment {}.with_ackno( start + 3 * mss ).with_win( mss ).with_payload_size( 0 ) );
+      test.execute( ExpectNoSegment {} );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,106 @@
+#include "random.hh"
+#include "tcp_peer_test_harness.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <string>
+
+using namespace std;
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      // A whole number of segments and of window units, so that SWS avoidance rounds none of it away
+      constexpr uint32_t capacity = 23 * 32 * 1460;
+      cfg.recv_capacity = capacity;
+      cfg.recv_autotune = false;
+      cfg.delayed_ack_ms = 0;
+      cfg.timestamps = false;
+
+      TCPPeerTestHarness test { "Windows are unscaled on SYNs and scaled both ways after them", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 1000 )
+                      .with_window_scale( 3 )
+                      .with_mss( 1460 ) );
+      test.execute( ExpectPeerWindow { 1000 } );
+
+      // The capacity needs a shift of 5, but the SYN-ACK's own window field is not scaled
+      test.execute(
+        ExpectSegment {}.with_syn( true ).with_ackno( peer_isn + 1 ).with_win( 65535 ).with_window_scale( 5 ) );
+
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 1000 ) );
+      test.execute( ExpectPeerWindow { 8000 } );
+
+      test.execute( SegmentArrives {}
+                      .with_seqno( peer_isn + 1 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 1000 )
+                      .with_data( string( 100, 'x' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( peer_isn + 101 ).with_win( ( capacity - 100 ) >> 5 ) );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.recv_capacity = 1024 * 1024;
+      cfg.recv_autotune = false;
+      cfg.timestamps = false;
+
+      TCPPeerTestHarness test { "A peer that offers no window scale gets none, and a shift of 0", cfg };
+      test.execute( SegmentArrives {}.with_syn().with_seqno( peer_isn ).with_win( 1000 ).with_mss( 1460 ) );
+      // Unscaled, 1 MiB is capped at 65535 bytes (and rounded down to whole segments)
+      test.execute( ExpectSegment {}.with_syn( true ).with_win( 44 * 1460 ).with_window_scale( nullopt ) );
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 1000 ) );
+      test.execute( ExpectPeerWindow { 1000 } );
+    }
+
+    {
+      TCPConfig cfg;
+      const Wrap32 isn( rd() );
+      const Wrap32 peer_isn( rd() );
+      cfg.fixed_isn = isn;
+      cfg.recv_capacity = uint64_t { 1 } << 31;
+      cfg.recv_autotune = false;
+      cfg.delayed_ack_ms = 0;
+      cfg.timestamps = false;
+
+      TCPPeerTestHarness test { "Shifts stop at 14, and the window at 65535 << 14", cfg };
+      test.execute( SegmentArrives {}
+                      .with_syn()
+                      .with_seqno( peer_isn )
+                      .with_win( 65535 )
+                      .with_window_scale( 15 )
+                      .with_mss( 1460 ) );
+      test.execute( ExpectSegment {}.with_syn( true ).with_win( 65535 ).with_window_scale( 14 ) );
+
+      test.execute( SegmentArrives {}.with_seqno( peer_isn + 1 ).with_ackno( isn + 1 ).with_win( 65535 ) );
+      test.execute( ExpectPeerWindow { uint64_t { 65535 } << 14 } );
+
+      test.execute( SegmentArrives {}
+                      .with_seqno( peer_isn + 1 )
+                      .with_ackno( isn + 1 )
+                      .with_win( 65535 )
+                      .with_data( string( 100, 'x' ) ) );
+      test.execute( ExpectSegment {}.with_ackno( peer_isn + 101 ).with_win( 65535 ) );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,222 @@
+#include "seqlock.hh"
+#include "tcp_peer.hh"
+#include "tcp_trace.hh"
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+void expect( bool cond, const string& what )
+{
+  if ( not cond ) {
+    throw runtime_error( what );
+  }
+}
+
+// Two peers with segments carried between them in rounds; optionally one of a's data segments is lost
+struct Link
+{
+  TCPPeer a;
+  TCPPeer b;
+  optional<size_t> lose {}; // index among a's data segments
+  size_t data_segments {};
+  size_t lost_bytes {};
+
+  Link( const TCPConfig& cfg_a, const TCPConfig& cfg_b ) : a( cfg_a ), b( cfg_b ) {}
+
+  // b answers each of a's segments before the next one arrives
+  bool b_replies()
+  {
+    bool moved = false;
+    while ( auto seg = b.maybe_send() ) {
+      moved = true;
+      a.receive( move( seg.value() ) );
+    }
+    return moved;
+  }
+
+  void exchange()
+  {
+    for ( int round = 0; round < 1000; round++ ) {
+      bool moved = b_replies();
+      while ( auto seg = a.maybe_send() ) {
+        moved = true;
+        if ( not seg->sender_message.payload.empty() and lose == data_segments++ ) {
+          lost_bytes += seg->sender_message.payload.size();
+          continue;
+        }
+        b.receive( move( seg.value() ) );
+        b_replies();
+      }
+      if ( not moved ) {
+        return;
+      }
+    }
+    throw runtime_error( "link did not go quiet" );
+  }
+};
+
+int main()
+{
+  try {
+    // A lost segment: out-of-order data and duplicate ACKs, and a retransmission
+    {
+      TCPConfig cfg;
+      Link link { cfg, cfg };
+      link.lose = 2;
+      link.a.push();
+      link.exchange();
+
+      link.a.outbound_writer().push( string( 10000, 'x' ) );
+      link.exchange();
+      expect( link.b.stats().out_of_order_bytes > 0, "no out-of-order bytes counted behind the hole" );
+      expect( link.a.stats().dup_acks > 0, "no duplicate ACKs counted" );
+
+      const uint64_t rto = link.a.stats().rto_ms;
+      expect( rto > 0, "no RTO reported" );
+      link.a.tick( rto );
+      link.exchange();
+      expect( link.b.inbound_reader().bytes_buffered() == 10000, "data did not arrive" );
+
+      const auto a = link.a.stats();
+      const auto b = link.b.stats();
+      expect( a.segments_retransmitted > 0 and a.bytes_retransmitted >= link.lost_bytes,
+              "the lost segment was not counted as retransmitted" );
+      expect( a.bytes_sent == 10000 + a.bytes_retransmitted, "bytes sent should include retransmissions" );
+      expect( a.segments_sent == b.segments_received + 1, "segments sent and received disagree" );
+      expect( b.segments_sent == a.segments_received, "segments sent and received disagree" );
+      expect( b.bytes_received == a.bytes_sent - link.lost_bytes, "bytes sent and received disagree" );
+      expect( a.sequence_numbers_in_flight == 0 and a.peer_window == b.window_advertised,
+              "window state disagrees after the transfer" );
+      expect( a.rto_ms == rto, "RTO should be back to normal once new data is acknowledged" );
+    }
+
+    // A receiver whose application is not reading closes its window
+    {
+      TCPConfig cfg;
+      TCPConfig small = cfg;
+      small.recv_capacity = 2000;
+      small.recv_autotune = false;
+      small.window_scaling = false;
+      Link link { cfg, small };
+      link.a.push();
+      link.exchange();
+      link.a.outbound_writer().push( string( 5000, 'y' ) );
+      for ( int i = 0; i < 3; i++ ) {
+        link.exchange();
+        link.b.tick( TCPConfig::MAX_DELAYED_ACK_MS ); // let delayed ACKs go
+      }
+      link.exchange();
+      expect( link.a.stats().peer_window == 0 and link.b.stats().window_advertised == 0, "window did not close" );
+      expect( link.a.stats().zero_windows_received == 1, "expected one zero window received" );
+      expect( link.b.stats().zero_windows_sent == 1, "expected one zero window sent" );
+
+      uint64_t read = 0;
+      for ( int i = 0; i < 100 and read < 5000; i++ ) {
+        read += link.b.inbound_reader().bytes_buffered();
+        link.b.inbound_reader().pop( link.b.inbound_reader().bytes_buffered() );
+        link.exchange();
+        link.a.tick( cfg.rt_timeout );
+        link.exchange();
+      }
+      expect( read == 5000, "data did not get through the reopened window" );
+      expect( link.a.stats().peer_window > 0, "window did not reopen" );
+    }
+
+    // The event trace records a tail loss and its repair by the retransmission timer, and survives a dump
+    {
+      TCPConfig cfg;
+      cfg.rack_tlp = false;
+      TCPConfig traced = cfg;
+      traced.trace_events = 16;
+      Link link { traced, cfg };
+      link.lose = 6; // the last of 10000 bytes' worth
+      link.a.push();
+      link.exchange();
+      link.a.outbound_writer().push( string( 10000, 'z' ) );
+      link.exchange();
+      link.b.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+      link.exchange();
+      link.a.tick( link.a.stats().rto_ms );
+      link.exchange();
+      link.b.tick( TCPConfig::MAX_DELAYED_ACK_MS );
+      link.exchange();
+      expect( link.b.inbound_reader().bytes_buffered() == 10000, "data did not arrive" );
+
+      const TCPTrace& trace = link.a.trace();
+      const auto events = trace.events();
+      expect( trace.recorded() > 16 and events.size() == 16, "ring did not keep the latest 16 events" );
+      expect( ranges::is_sorted( events, {}, &TCPTrace::Event::time_ns ), "events are out of order" );
+
+      const auto rto = ranges::find( events, TCPTrace::Kind::RtoFired, &TCPTrace::Event::kind );
+      expect( rto != events.end() and rto->length == 1, "RTO not traced" );
+      const auto retx = ranges::find( events, TCPTrace::Kind::Retransmitted, &TCPTrace::Event::kind );
+      expect( retx > rto and retx->length == link.lost_bytes, "retransmission not traced after the RTO" );
+      const auto ack = ranges::find( retx, events.end(), TCPTrace::Kind::AckReceived, &TCPTrace::Event::kind );
+      expect( ack != events.end() and ack->seqno == retx->seqno + retx->length, "final ACK not traced" );
+
+      const string path = "tcp_stats_trace.bin";
+      trace.dump( path );
+      ifstream file { path, ios::binary };
+      stringstream contents;
+      contents << file.rdbuf();
+      file.close();
+      remove( path.c_str() );
+      uint64_t recorded = 0;
+      const auto parsed = TCPTrace::parse( contents.str(), recorded );
+      expect( recorded == trace.recorded() and parsed.size() == events.size(), "dump lost events" );
+      for ( size_t i = 0; i < parsed.size(); i++ ) {
+        expect( parsed[i].time_ns == events[i].time_ns and parsed[i].kind == events[i].kind
+                  and parsed[i].seqno == events[i].seqno and parsed[i].length == events[i].length
+                  and parsed[i].value == events[i].value,
+                "dump changed an event" );
+      }
+      expect( not link.b.trace().enabled(), "an untraced peer should keep no ring" );
+
+      TCPTrace disabled;
+      disabled.record( TCPTrace::Kind::RtoFired, 0, 1, 0 );
+      expect( disabled.recorded() == 0 and disabled.events().empty(), "a disabled trace recorded an event" );
+    }
+
+    // A reader never sees a snapshot torn by a concurrent store
+    {
+      SeqLock<TCPStats> published;
+      atomic_bool done { false };
+      thread writer( [&] {
+        for ( uint64_t i = 1; i <= 200000; i++ ) {
+          TCPStats s;
+          s.segments_sent = s.bytes_sent = s.dup_acks = s.rto_ms = s.sequence_numbers_in_flight = i;
+          published.store( s );
+        }
+        done = true;
+      } );
+
+      uint64_t last = 0;
+      bool ok = true;
+      while ( not done ) {
+        const TCPStats s = published.load();
+        ok &= s.segments_sent == s.bytes_sent and s.bytes_sent == s.dup_acks and s.dup_acks == s.rto_ms
+              and s.rto_ms == s.sequence_numbers_in_flight and s.segments_sent >= last;
+        last = s.segments_sent;
+      }
+      writer.join();
+      expect( ok, "read a torn or stale snapshot" );
+      expect( published.load().segments_sent == 200000, "missed the last store" );
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
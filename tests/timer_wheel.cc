@@ -0,0 +1,123 @@
+#include "timer_wheel.hh"
+#include "random.hh"
+
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+// Drive the wheel and a naive model (a map from id to deadline) with the same random
+// arm/cancel/advance sequence, and check that exactly the same timers fire at the same times.
+void check_against_model( default_random_engine& rd, const uint64_t max_delay )
+{
+  TimerWheel wheel;
+  map<TimerWheel::TimerId, uint64_t> model;
+
+  vector<TimerWheel::TimerId> ids;
+  for ( uint64_t owner = 0; owner < 64; owner++ ) {
+    ids.push_back( wheel.add( owner, static_cast<TimerWheel::Kind>( owner % 4 ) ) );
+  }
+
+  uniform_int_distribution<size_t> pick { 0, ids.size() - 1 };
+  uniform_int_distribution<uint64_t> delay { 0, max_delay };
+  uniform_int_distribution<uint64_t> step { 1, max_delay / 8 + 1 };
+  uniform_int_distribution<int> op { 0, 9 };
+
+  for ( unsigned int i = 0; i < 20000; i++ ) {
+    const auto id = ids[pick( rd )];
+    switch ( op( rd ) ) {
+      case 0:
+      case 1:
+        wheel.cancel( id );
+        model.erase( id );
+        break;
+      case 2:
+      case 3:
+      case 4: {
+        const uint64_t d = delay( rd );
+        wheel.arm( id, d );
+        model[id] = wheel.now() + max( d, uint64_t { 1 } );
+        break;
+      }
+      default: {
+        const uint64_t ms = step( rd );
+        uint64_t last = 0;
+        wheel.advance( ms, [&]( TimerWheel::TimerId fired, uint64_t owner, TimerWheel::Kind kind ) {
+          if ( not model.contains( fired ) ) {
+            throw runtime_error( "timer fired that was not armed" );
+          }
+          if ( model[fired] != wheel.now() ) {
+            ostringstream ss;
+            ss << "timer fired at " << wheel.now() << " but was due at " << model[fired];
+            throw runtime_error( ss.str() );
+          }
+          if ( wheel.now() < last ) {
+            throw runtime_error( "timers fired out of order" );
+          }
+          if ( owner != wheel.owner( fired ) or kind != wheel.kind( fired ) ) {
+            throw runtime_error( "wrong owner or kind passed to callback" );
+          }
+          last = wheel.now();
+          model.erase( fired );
+        } );
+        for ( const auto& [pending, deadline] : model ) {
+          if ( deadline <= wheel.now() ) {
+            ostringstream ss;
+            ss << "timer due at " << deadline << " did not fire by " << wheel.now();
+            throw runtime_error( ss.str() );
+          }
+          if ( not wheel.armed( pending ) ) {
+            throw runtime_error( "pending timer reported as disarmed" );
+          }
+        }
+        break;
+      }
+    }
+    if ( wheel.armed_count() != model.size() ) {
+      throw runtime_error( "armed_count() disagrees with model" );
+    }
+  }
+}
+
+int main()
+{
+  try {
+    auto rd = get_random_engine();
+
+    // level 0 only, a couple of levels, and deadlines beyond the top level
+    check_against_model( rd, 50 );
+    check_against_model( rd, 5000 );
+    check_against_model( rd, 500000 );
+    check_against_model( rd, uint64_t { 1 } << 26 );
+
+    // re-arming from inside the callback
+    {
+      TimerWheel wheel;
+      const auto id = wheel.add( 7, TimerWheel::Kind::Retransmission );
+      wheel.arm( id, 10 );
+      unsigned fired = 0;
+      for ( unsigned i = 0; i < 10; i++ ) {
+        wheel.advance( 10, [&]( TimerWheel::TimerId t, uint64_t, TimerWheel::Kind ) {
+          fired++;
+          wheel.arm( t, 10 );
+        } );
+      }
+      if ( fired != 10 ) {
+        throw runtime_error( "periodic timer fired " + to_string( fired ) + " times, expected 10" );
+      }
+      wheel.remove( id );
+      if ( wheel.armed_count() != 0 ) {
+        throw runtime_error( "removed timer still armed" );
+      }
+    }
+  } catch ( const exception& e ) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -19,6 +19,8 @@ std::string to_string( EthernetAddress address );
 struct EthernetHeader
 {
   static constexpr size_t LENGTH = 14;         //!< Ethernet header length in bytes
+  static constexpr size_t DEFAULT_MTU = 1500;  //!< Largest payload of a standard frame
+  static constexpr size_t MAX_MTU = 9000;      //!< Largest payload of a jumbo frame
   static constexpr uint16_t TYPE_IPv4 = 0x800; //!< Type number for [IPv4](\ref rfc::rfc791)
   static constexpr uint16_t TYPE_ARP = 0x806;  //!< Type number for [ARP](\ref rfc::rfc826)
 
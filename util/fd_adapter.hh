@@ -37,6 +37,10 @@ public:
   //! \returns a mutable reference
   FdAdapterConfig& config_mut() { return _cfg; }
 
+  //! \brief Replace the configuration
+  //! \param[in] cfg is the new configuration
+  void set_config( const FdAdapterConfig& cfg ) { _cfg = cfg; }
+
   //! Called periodically when time elapses
   void tick( const size_t unused [[maybe_unused]] ) {}
 };
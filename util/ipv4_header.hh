@@ -13,6 +13,13 @@ struct IPv4Header
   static constexpr uint8_t DEFAULT_TTL = 128; // A reasonable default TTL value
   static constexpr uint8_t PROTO_TCP = 6;     // Protocol number for TCP
 
+  // ECN codepoints (RFC 3168): the two low bits of the type-of-service field
+  static constexpr uint8_t ECN_MASK = 0b11;
+  static constexpr uint8_t ECN_NOT_ECT = 0b00; // transport is not ECN-capable
+  static constexpr uint8_t ECN_ECT1 = 0b01;    // ECN-capable transport
+  static constexpr uint8_t ECN_ECT0 = 0b10;    // ECN-capable transport
+  static constexpr uint8_t ECN_CE = 0b11;      // congestion experienced
+
   static constexpr uint64_t serialized_length() { return LENGTH; }
 
   /*
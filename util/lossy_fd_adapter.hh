@@ -8,6 +8,7 @@
 #include <optional>
 #include <random>
 #include <utility>
+#include <vector>
 
 //! An adapter class that adds random dropping behavior to an FD adapter
 template<typename AdapterT>
@@ -59,6 +60,16 @@ public:
     return _adapter.write( seg );
   }
 
+  //! \brief Write a batch to the underlying AdapterT instance, dropping each segment independently
+  //! \param[in] segs are the packets to either write or drop; dropped ones are removed from the batch
+  void write( std::vector<TCPSegment>& segs )
+  {
+    std::erase_if( segs, [&]( const TCPSegment& ) { return _should_drop( true ); } );
+    if ( not segs.empty() ) {
+      _adapter.write( segs );
+    }
+  }
+
   //! \name
   //! Passthrough functions to the underlying AdapterT instance
 
@@ -66,4 +77,6 @@ public:
   const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
   FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
   void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+  //! FdAdapterBase::set_config passthrough
+  void set_config( const FdAdapterConfig& cfg ) { _adapter.set_config( cfg ); }
 };
@@ -0,0 +1,103 @@
+#include "neighbor_table.hh"
+#include "random.hh"
+
+#include <algorithm>
+#include <bit>
+
+using namespace std;
+
+static constexpr size_t MIN_SLOTS = 16;
+
+static_assert( sizeof( NeighborTable::Neighbor ) == 32 );
+
+namespace {
+
+// Slots needed to hold `n` entries at a load factor of at most 3/4
+size_t slots_for( size_t n )
+{
+  return bit_ceil( max( MIN_SLOTS, n + n / 3 + 1 ) );
+}
+
+} // namespace
+
+NeighborTable::NeighborTable( const size_t expected_size )
+{
+  auto rd = get_random_engine();
+  seed_ = mix64( static_cast<uint64_t>( rd() ) << 32 ^ rd() );
+  slots_.resize( slots_for( expected_size ) );
+  mask_ = slots_.size() - 1;
+}
+
+size_t NeighborTable::home( const uint32_t ip ) const
+{
+  return mix64( ip ^ seed_ ) & mask_;
+}
+
+// The slot holding `ip`, or the empty slot that ends its probe run
+size_t NeighborTable::probe( const uint32_t ip ) const
+{
+  size_t index = home( ip );
+  while ( slots_[index].state != State::Empty and slots_[index].ip != ip ) {
+    index = ( index + 1 ) & mask_;
+  }
+  return index;
+}
+
+void NeighborTable::rehash( const size_t new_slot_count )
+{
+  vector<Neighbor> old( new_slot_count );
+  swap( old, slots_ );
+  mask_ = slots_.size() - 1;
+  for ( const auto& slot : old ) {
+    if ( slot.state != State::Empty ) {
+      slots_[probe( slot.ip )] = slot;
+    }
+  }
+}
+
+NeighborTable::Neighbor* NeighborTable::find( const uint32_t ip )
+{
+  Neighbor& slot = slots_[probe( ip )];
+  return slot.state == State::Empty ? nullptr : &slot;
+}
+
+const NeighborTable::Neighbor* NeighborTable::find( const uint32_t ip ) const
+{
+  const Neighbor& slot = slots_[probe( ip )];
+  return slot.state == State::Empty ? nullptr : &slot;
+}
+
+NeighborTable::Neighbor& NeighborTable::emplace( const uint32_t ip )
+{
+  if ( Neighbor* existing = find( ip ) ) {
+    return *existing;
+  }
+  if ( slots_for( size_ + 1 ) > slots_.size() ) {
+    rehash( slots_.size() * 2 );
+  }
+  Neighbor& slot = slots_[probe( ip )];
+  slot = Neighbor { .ip = ip, .state = State::Incomplete };
+  size_++;
+  return slot;
+}
+
+bool NeighborTable::erase( const uint32_t ip )
+{
+  size_t hole = probe( ip );
+  if ( slots_[hole].state == State::Empty ) {
+    return false;
+  }
+
+  // Shift back every later member of the run that may live at or before the hole
+  for ( size_t next = ( hole + 1 ) & mask_; slots_[next].state != State::Empty; next = ( next + 1 ) & mask_ ) {
+    const size_t want = home( slots_[next].ip );
+    const bool stays = hole < next ? ( hole < want and want <= next ) : ( hole < want or want <= next );
+    if ( not stays ) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+  slots_[hole] = Neighbor {};
+  size_--;
+  return true;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "ethernet_header.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <vector>
+
+// The neighbors a network interface knows about, keyed by IPv4 address: each one's resolution state, Ethernet
+// address, next deadline, and the queue of datagrams waiting for it to resolve.
+//
+// Like TCPConnectionTable, the table is open-addressed with linear probing and backward-shift erase, keyed
+// with a per-table random seed. A neighbor's whole entry fits in 32 bytes, so a lookup for a send or a
+// receive usually touches one cache line.
+//
+// Each neighbor has one deadline at a time (what it means depends on its state), kept in a min-heap so
+// that expire() visits only the neighbors whose deadline has passed. Moving a deadline later is only a
+// write to the entry: its heap entry stays where it is, and is requeued at the new deadline when it comes
+// up. So there is at most one live heap entry per neighbor, and refreshing a busy neighbor costs nothing
+// beyond the lookup.
+class NeighborTable
+{
+public:
+  enum class State : uint8_t
+  {
+    Empty,      // marks an unused slot
+    Incomplete, // an ARP request is outstanding
+    Reachable,  // the Ethernet address is known
+    Stale,      // the Ethernet address is known, but due to be confirmed
+    Static,     // the Ethernet address was configured, and never expires
+  };
+
+  static constexpr uint32_t NO_QUEUE = UINT32_MAX;
+
+  struct alignas( 32 ) Neighbor
+  {
+    uint32_t ip {};
+    State state { State::Empty };
+    EthernetAddress ethernet_address {};
+    uint8_t flags {};            // the owner's to use
+    uint32_t queue { NO_QUEUE }; // index of the owner's queue of datagrams waiting for this neighbor
+    uint64_t deadline {};        // when the neighbor's state next needs attention (ms)
+    uint64_t queued_at {};       // when this neighbor's live heap entry comes up (0: none)
+  };
+
+private:
+  std::vector<Neighbor> slots_ {};
+  uint64_t mask_ {};
+  size_t size_ {};
+  uint64_t seed_ {};
+
+  struct Deadline
+  {
+    uint64_t when;
+    uint32_t ip;
+    bool operator>( const Deadline& other ) const { return when > other.when; }
+  };
+  std::priority_queue<Deadline, std::vector<Deadline>, std::greater<>> deadlines_ {};
+
+  size_t home( uint32_t ip ) const;
+  size_t probe( uint32_t ip ) const;
+  void rehash( size_t new_slot_count );
+
+public:
+  explicit NeighborTable( size_t expected_size = 0 );
+
+  // The neighbor with address `ip`, or nullptr. Like the reference from emplace(), the pointer is good
+  // until the next emplace() or erase().
+  Neighbor* find( uint32_t ip );
+  const Neighbor* find( uint32_t ip ) const;
+
+  // The neighbor with address `ip`, added as Incomplete (with no deadline) if there was none
+  Neighbor& emplace( uint32_t ip );
+
+  // Remove the neighbor with address `ip`; returns false if there was none
+  bool erase( uint32_t ip );
+
+  // Set the neighbor's deadline, to the absolute time `when` (ms, > 0)
+  void set_deadline( Neighbor& neighbor, uint64_t when )
+  {
+    neighbor.deadline = when;
+    if ( neighbor.queued_at == 0 or when < neighbor.queued_at ) {
+      neighbor.queued_at = when;
+      deadlines_.push( { when, neighbor.ip } );
+    }
+  }
+
+  // Call on_deadline( neighbor ) for each neighbor whose deadline is at or before `now`. The callback may
+  // set a later deadline, erase the neighbor, or leave it with no deadline; it may do nothing else to the table.
+  // (A neighbor whose deadline is set to 0 is handed to the callback when its old deadline comes up.)
+  template<typename F>
+  void expire( uint64_t now, F&& on_deadline )
+  {
+    while ( not deadlines_.empty() and deadlines_.top().when <= now ) {
+      const Deadline d = deadlines_.top();
+      deadlines_.pop();
+
+      Neighbor* neighbor = find( d.ip );
+      if ( neighbor == nullptr or neighbor->queued_at != d.when ) {
+        continue; // the neighbor is gone, or this entry was superseded
+      }
+      if ( neighbor->deadline > now ) {
+        neighbor->queued_at = neighbor->deadline;
+        deadlines_.push( { neighbor->deadline, d.ip } );
+        continue;
+      }
+      neighbor->queued_at = 0;
+      on_deadline( *neighbor );
+    }
+  }
+
+  size_t size() const { return size_; }
+  size_t pending_deadlines() const { return deadlines_.size(); } // heap entries, live or not
+};
@@ -71,11 +71,7 @@ class Parser
       if ( empty() ) {
         return;
       }
-      std::string first_str = std::move( buffer_.front() );
-      if ( skip_ ) {
-        first_str = first_str.substr( skip_ );
-      }
-      out.emplace_back( std::move( first_str ) );
+      out.emplace_back( std::string( peek() ) ); // one copy, of only the bytes not yet parsed
       buffer_.pop_front();
       for ( auto&& x : buffer_ ) {
         out.emplace_back( std::move( x ) );
@@ -194,14 +190,17 @@ public:
     }
   }
 
-  // flush buffer_(may append null Buffer) and move buf to output
+  // append raw bytes to internal buffer
+  void string( std::string_view str ) { buffer_.append( str ); }
+
+  // flush buffer_ and append buf (shared, not copied) to output
   void buffer( const Buffer& buf )
   {
     flush();
     output_.push_back( buf );
   }
 
-  // move bufs to output. May insert null Buffer
+  // append bufs (shared, not copied) to output
   void buffer( const std::vector<Buffer>& bufs )
   {
     for ( const auto& b : bufs ) {
@@ -209,18 +208,20 @@ public:
     }
   }
 
-  // append buffer_ to output_
+  // append buffer_ (if not empty) to output_
   void flush()
   {
-    output_.emplace_back( std::move( buffer_ ) );
-    buffer_.clear();
+    if ( not buffer_.empty() ) {
+      output_.emplace_back( std::move( buffer_ ) );
+      buffer_.clear();
+    }
   }
 
-  // flush buffer_ and return output
+  // flush buffer_ and hand over the output (leaving the Serializer empty)
   std::vector<Buffer> output()
   {
     flush();
-    return output_;
+    return std::move( output_ );
   }
 };
 
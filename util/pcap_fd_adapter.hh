@@ -0,0 +1,102 @@
+#pragma once
+
+#include "file_descriptor.hh"
+#include "parser.hh"
+#include "pcap_writer.hh"
+#include "tcp_config.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+//! An adapter class that records the segments an FD adapter reads and writes in a pcap file
+//!
+//! Each segment is captured as the IPv4 datagram that carries it between config().source and
+//! config().destination (rebuilt from the parsed segment, so IP fields such as the ID and TTL are not
+//! those on the wire). Wrap it inside a LossyFdAdapter to capture only what the loss leaves. With no
+//! capture file, it passes everything through untouched.
+template<typename AdapterT>
+class PcapFdAdapter
+{
+private:
+  //! The underlying FD adapter
+  AdapterT _adapter;
+
+  //! Capture file, if capturing
+  std::unique_ptr<PcapWriter> _pcap;
+
+  //! \brief Record a segment as the datagram that carries it
+  //! \param[in] outbound is `true` for a segment we write, else one we read
+  void _record( const TCPSegment& seg, bool outbound )
+  {
+    const auto& cfg = _adapter.config();
+    const uint32_t source = cfg.source.ipv4_numeric();
+    const uint32_t destination = cfg.destination.ipv4_numeric();
+    TCPSegment copy = seg;
+    const auto dgram
+      = outbound
+          ? wrap_tcp_in_ip( copy, { source, destination, cfg.source.port(), cfg.destination.port() } )
+          : wrap_tcp_in_ip( copy, { destination, source, seg.udinfo.src_port, seg.udinfo.dst_port } );
+    _pcap->record( serialize( dgram ) );
+  }
+
+public:
+  //! Conversion to a FileDescriptor by returning the underlying AdapterT
+  FileDescriptor& fd() { return _adapter.fd(); }
+
+  //! Construct from the adapter to capture, and the file to capture to (none if `pcap_path` is empty)
+  PcapFdAdapter( AdapterT&& adapter, const std::string& pcap_path )
+    : _adapter( std::move( adapter ) )
+    , _pcap( pcap_path.empty() ? nullptr : std::make_unique<PcapWriter>( pcap_path ) )
+  {}
+
+  //! \brief Read from the underlying AdapterT instance, recording what it returns
+  std::optional<TCPSegment> read()
+  {
+    auto ret = _adapter.read();
+    if ( _pcap and ret.has_value() ) {
+      _record( ret.value(), false );
+    }
+    return ret;
+  }
+
+  //! \brief Write to the underlying AdapterT instance, recording the segment
+  void write( TCPSegment& seg )
+  {
+    if ( _pcap ) {
+      _record( seg, true );
+    }
+    _adapter.write( seg );
+  }
+
+  //! \brief Write a batch to the underlying AdapterT instance, recording each segment
+  void write( std::vector<TCPSegment>& segs )
+  {
+    if ( _pcap ) {
+      for ( const auto& seg : segs ) {
+        _record( seg, true );
+      }
+    }
+    _adapter.write( segs );
+  }
+
+  //! Is a capture file being written?
+  bool capturing() const { return _pcap != nullptr; }
+
+  //! The underlying adapter
+  AdapterT& adapter() { return _adapter; }
+
+  //! \name
+  //! Passthrough functions to the underlying AdapterT instance
+
+  void set_listening( const bool l ) { _adapter.set_listening( l ); } //!< FdAdapterBase::set_listening passthrough
+  const FdAdapterConfig& config() const { return _adapter.config(); } //!< FdAdapterBase::config passthrough
+  FdAdapterConfig& config_mut() { return _adapter.config_mut(); }     //!< FdAdapterBase::config_mut passthrough
+  void tick( const size_t ms_since_last_tick ) { _adapter.tick( ms_since_last_tick ); }
+  //! FdAdapterBase::set_config passthrough
+  void set_config( const FdAdapterConfig& cfg ) { _adapter.set_config( cfg ); }
+};
@@ -0,0 +1,117 @@
+#include "pcap_writer.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+
+using namespace std;
+
+namespace {
+
+// pcap files are written in the byte order of the host that writes them (readers tell by the magic)
+template<typename T>
+void append_host_order( string& out, const T value )
+{
+  char bytes[sizeof( T )];
+  memcpy( bytes, &value, sizeof( T ) );
+  out.append( bytes, sizeof( T ) );
+}
+
+} // namespace
+
+PcapWriter::PcapWriter( const string& path ) : file_( path, ios::binary | ios::trunc )
+{
+  if ( not file_ ) {
+    throw runtime_error( "PcapWriter: could not open " + path );
+  }
+
+  string header;
+  append_host_order( header, MAGIC_NANOSECONDS );
+  append_host_order( header, uint16_t { 2 } ); // version 2.4
+  append_host_order( header, uint16_t { 4 } );
+  append_host_order( header, int32_t { 0 } );  // timestamps are UTC
+  append_host_order( header, uint32_t { 0 } ); // accuracy
+  append_host_order( header, SNAPLEN );
+  append_host_order( header, LINKTYPE_RAW );
+  file_.write( header.data(), static_cast<streamsize>( header.size() ) );
+
+  flusher_ = thread( &PcapWriter::flush_loop, this );
+}
+
+PcapWriter::~PcapWriter()
+{
+  {
+    const lock_guard lock { mutex_ };
+    stop_ = true;
+  }
+  wake_.notify_one();
+  flusher_.join();
+  if ( dropped_ > 0 ) {
+    cerr << "DEBUG: PcapWriter dropped " << dropped_ << " packets while the file fell behind.\n";
+  }
+}
+
+void PcapWriter::record( const vector<Buffer>& packet )
+{
+  const auto now = chrono::duration_cast<chrono::nanoseconds>( chrono::system_clock::now().time_since_epoch() );
+  size_t length = 0;
+  for ( const auto& b : packet ) {
+    length += b.size();
+  }
+  const auto captured = static_cast<uint32_t>( min<size_t>( length, SNAPLEN ) );
+
+  bool flush_now = false;
+  {
+    const lock_guard lock { mutex_ };
+    if ( pending_.size() + RECORD_HEADER_LENGTH + captured > MAX_PENDING_BYTES ) {
+      dropped_++;
+      return;
+    }
+    append_host_order( pending_, static_cast<uint32_t>( now.count() / 1'000'000'000 ) );
+    append_host_order( pending_, static_cast<uint32_t>( now.count() % 1'000'000'000 ) );
+    append_host_order( pending_, captured );
+    append_host_order( pending_, static_cast<uint32_t>( length ) );
+    size_t left = captured;
+    for ( const auto& b : packet ) {
+      const string_view bytes = string_view( b ).substr( 0, left );
+      pending_.append( bytes );
+      left -= bytes.size();
+    }
+    flush_now = pending_.size() >= FLUSH_BYTES;
+  }
+  if ( flush_now ) {
+    wake_.notify_one();
+  }
+}
+
+uint64_t PcapWriter::dropped()
+{
+  const lock_guard lock { mutex_ };
+  return dropped_;
+}
+
+void PcapWriter::flush_loop()
+{
+  string batch;
+  unique_lock lock { mutex_ };
+  while ( true ) {
+    wake_.wait_for( lock, chrono::milliseconds( FLUSH_INTERVAL_MS ), [&] {
+      return stop_ or pending_.size() >= FLUSH_BYTES;
+    } );
+    const bool stopping = stop_;
+    swap( batch, pending_ );
+
+    lock.unlock();
+    file_.write( batch.data(), static_cast<streamsize>( batch.size() ) );
+    file_.flush();
+    batch.clear();
+    lock.lock();
+
+    if ( stopping ) {
+      return;
+    }
+  }
+}
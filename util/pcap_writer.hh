@@ -0,0 +1,60 @@
+#pragma once
+
+#include "buffer.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes raw IPv4 packets to a pcap file (nanosecond timestamps, link type RAW), for Wireshark or tcpdump -r.
+//
+// record() only stamps and copies the packet into a buffer; a background thread writes the buffer out
+// every FLUSH_INTERVAL_MS (or sooner once FLUSH_BYTES have piled up), so capturing adds no file I/O to
+// the caller's path. Should the file fall behind by MAX_PENDING_BYTES, further packets are dropped (and
+// counted) rather than held. The destructor writes out everything recorded.
+class PcapWriter
+{
+public:
+  static constexpr uint32_t MAGIC_NANOSECONDS = 0xa1b2'3c4d;
+  static constexpr uint32_t LINKTYPE_RAW = 101;
+  static constexpr uint32_t SNAPLEN = 65535;
+  static constexpr size_t FILE_HEADER_LENGTH = 24;
+  static constexpr size_t RECORD_HEADER_LENGTH = 16;
+
+  static constexpr uint64_t FLUSH_INTERVAL_MS = 100;
+  static constexpr size_t FLUSH_BYTES = 1 << 20;
+  static constexpr size_t MAX_PENDING_BYTES = 64 << 20;
+
+private:
+  std::ofstream file_;
+
+  std::mutex mutex_ {};
+  std::condition_variable wake_ {};
+  std::string pending_ {}; // records not yet handed to the flush thread
+  uint64_t dropped_ {};
+  bool stop_ {};
+
+  std::thread flusher_ {};
+
+  void flush_loop();
+
+public:
+  // Create (or truncate) the file and start the flush thread; throws if the file cannot be opened
+  explicit PcapWriter( const std::string& path );
+  ~PcapWriter();
+
+  PcapWriter( const PcapWriter& ) = delete;
+  PcapWriter& operator=( const PcapWriter& ) = delete;
+  PcapWriter( PcapWriter&& ) = delete;
+  PcapWriter& operator=( PcapWriter&& ) = delete;
+
+  // Record one packet (an IPv4 datagram, serialized), timestamped now
+  void record( const std::vector<Buffer>& packet );
+
+  uint64_t dropped();
+};
@@ -0,0 +1,84 @@
+#include "prefix_table.hh"
+
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+PrefixTable::PrefixTable()
+{
+  clear();
+}
+
+void PrefixTable::clear()
+{
+  slots_.assign( ROOT_SLOTS, 0 );
+  lengths_.assign( ROOT_SLOTS, 0 );
+}
+
+void PrefixTable::reserve( const size_t chunks )
+{
+  slots_.reserve( ROOT_SLOTS + chunks * CHUNK_SLOTS );
+  lengths_.reserve( ROOT_SLOTS + chunks * CHUNK_SLOTS );
+}
+
+size_t PrefixTable::child_of( const size_t index )
+{
+  if ( slots_[index] & CHILD ) {
+    return chunk_base( slots_[index] );
+  }
+
+  const auto chunk = static_cast<uint32_t>( chunks() );
+  if ( chunk >= CHILD ) {
+    throw runtime_error( "PrefixTable: too many chunks" );
+  }
+  const size_t base = slots_.size();
+  slots_.resize( base + CHUNK_SLOTS, slots_[index] );
+  lengths_.resize( base + CHUNK_SLOTS, lengths_[index] );
+  slots_[index] = CHILD | chunk;
+  return base;
+}
+
+// A chunk's slots never hold a shorter prefix than the slot above the chunk (which keeps the longest prefix
+// that covers all of them), so a chunk only needs visiting when the prefix is longer than that one.
+void PrefixTable::fill( const size_t begin, const size_t end, const uint32_t slot, const uint8_t length )
+{
+  for ( size_t i = begin; i < end; i++ ) {
+    if ( lengths_[i] >= length ) {
+      continue;
+    }
+    lengths_[i] = length;
+    if ( slots_[i] & CHILD ) {
+      const size_t base = chunk_base( slots_[i] );
+      fill( base, base + CHUNK_SLOTS, slot, length );
+    } else {
+      slots_[i] = slot;
+    }
+  }
+}
+
+void PrefixTable::insert( uint32_t prefix, const uint8_t length, const Value value )
+{
+  if ( length > 32 ) {
+    throw runtime_error( "PrefixTable: prefix length " + to_string( length ) + " is longer than 32" );
+  }
+  if ( value > MAX_VALUE ) {
+    throw runtime_error( "PrefixTable: value out of range" );
+  }
+  prefix &= length == 0 ? 0 : UINT32_MAX << ( 32 - length );
+
+  size_t begin {};
+  size_t count {};
+  if ( length <= 16 ) {
+    begin = prefix >> 16;
+    count = size_t { 1 } << ( 16 - length );
+  } else if ( length <= 24 ) {
+    begin = child_of( prefix >> 16 ) + ( ( prefix >> 8 ) & 0xff );
+    count = size_t { 1 } << ( 24 - length );
+  } else {
+    begin = child_of( child_of( prefix >> 16 ) + ( ( prefix >> 8 ) & 0xff ) ) + ( prefix & 0xff );
+    count = size_t { 1 } << ( 32 - length );
+  }
+
+  fill( begin, begin + count, value + 1, static_cast<uint8_t>( length + 1 ) );
+}
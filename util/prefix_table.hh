@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A longest-prefix-match table from IPv4 prefixes to values, for a router's forwarding lookups.
+//
+// The table is a multibit trie with strides of 16, 8, and 8 bits: a root of 2^16 slots indexed by the top
+// 16 bits of an address, and chunks of 256 slots for the next 8 bits and the last 8, made only under the
+// root (or level-1) slots that prefixes longer than 16 (or 24) bits fall in. Prefixes are pushed to the
+// leaves, so every slot holds the answer for its whole range, or the chunk to look in next: a lookup reads
+// one, two, or three slots, and nothing else.
+//
+// Each slot also records the length of the prefix that its value came from, so that inserting a prefix
+// overwrites only the slots that no longer (or equally long) prefix already claims. So tables can be built
+// in any order, and the first value given for a prefix is the one that stays.
+class PrefixTable
+{
+public:
+  using Value = uint32_t;
+  static constexpr Value NONE = UINT32_MAX;
+  static constexpr Value MAX_VALUE = ( 1U << 31 ) - 2;
+
+private:
+  static constexpr uint32_t CHILD = 1U << 31; // a slot that names a chunk (by number) rather than a value
+  static constexpr size_t ROOT_SLOTS = 1 << 16;
+  static constexpr size_t CHUNK_SLOTS = 1 << 8;
+
+  // Slot i of the root, then chunk n at ROOT_SLOTS + n * CHUNK_SLOTS. A slot holds CHILD | n, or value + 1
+  // (0: no route), and its prefix length + 1 (0: no route).
+  std::vector<uint32_t> slots_ {};
+  std::vector<uint8_t> lengths_ {};
+
+  static size_t chunk_base( uint32_t slot ) { return ROOT_SLOTS + ( slot & ~CHILD ) * CHUNK_SLOTS; }
+
+  // The chunk under `index`, made (inheriting the slot's value) if there was none
+  size_t child_of( size_t index );
+
+  // Claim slots [begin, end) for a prefix of (stored) length `length`, descending into chunks beneath them
+  void fill( size_t begin, size_t end, uint32_t slot, uint8_t length );
+
+public:
+  PrefixTable();
+
+  // Map the addresses that start with the first `length` (0 to 32) bits of `prefix` to `value`, where no longer
+  // prefix maps them. A prefix already in the table keeps its value.
+  void insert( uint32_t prefix, uint8_t length, Value value );
+
+  // The value of the longest prefix that `address` starts with, or NONE
+  Value find( uint32_t address ) const
+  {
+    uint32_t slot = slots_[address >> 16];
+    if ( slot & CHILD ) {
+      slot = slots_[chunk_base( slot ) + ( ( address >> 8 ) & 0xff )];
+      if ( slot & CHILD ) {
+        slot = slots_[chunk_base( slot ) + ( address & 0xff )];
+      }
+    }
+    return slot - 1; // 0 - 1 is NONE
+  }
+
+  void clear();
+
+  // Make room for `chunks` chunks, so that the table is not copied as inserts make them
+  void reserve( size_t chunks );
+
+  size_t chunks() const { return ( slots_.size() - ROOT_SLOTS ) / CHUNK_SLOTS; }     // level-1 and -2 chunks
+  size_t memory_bytes() const { return slots_.size() * ( sizeof( uint32_t ) + 1 ); } // slots and lengths
+};
@@ -13,3 +13,13 @@ default_random_engine get_random_engine()
   seed_seq seed( seed_data.begin(), seed_data.end() );
   return default_random_engine( seed );
 }
+
+uint64_t mix64( uint64_t x )
+{
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <random>
 
 std::default_random_engine get_random_engine();
+
+// splitmix64's finalizer: every input bit affects every output bit (a mixer for hashing, not a secure PRF)
+uint64_t mix64( uint64_t x );
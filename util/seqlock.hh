@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// A value that one thread publishes and other threads read without locks (a sequence lock).
+//
+// The writer makes the sequence number odd, stores the value, and makes it even again; a reader copies the
+// value between two reads of the sequence number and starts over if they differ or are odd, so it always
+// sees one whole store and never makes the writer wait. The value is kept in relaxed atomic words, so the
+// copying that races with a store is not a data race. Only one thread may call store().
+template<typename T>
+class SeqLock
+{
+  static_assert( std::is_trivially_copyable_v<T> and std::is_default_constructible_v<T> );
+
+  static constexpr size_t WORDS = ( sizeof( T ) + sizeof( uint64_t ) - 1 ) / sizeof( uint64_t );
+  using Words = std::array<uint64_t, WORDS>;
+
+  std::atomic<uint64_t> seq_ {};
+  std::array<std::atomic<uint64_t>, WORDS> words_ {};
+
+public:
+  explicit SeqLock( const T& value = {} ) { store( value ); }
+
+  void store( const T& value )
+  {
+    Words words {};
+    std::memcpy( words.data(), &value, sizeof( T ) );
+
+    const uint64_t seq = seq_.load( std::memory_order_relaxed );
+    seq_.store( seq + 1, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+    for ( size_t i = 0; i < WORDS; i++ ) {
+      words_[i].store( words[i], std::memory_order_relaxed );
+    }
+    seq_.store( seq + 2, std::memory_order_release );
+  }
+
+  T load() const
+  {
+    Words words {};
+    while ( true ) {
+      const uint64_t before = seq_.load( std::memory_order_acquire );
+      if ( before & 1 ) {
+        continue;
+      }
+      for ( size_t i = 0; i < WORDS; i++ ) {
+        words[i] = words_[i].load( std::memory_order_relaxed );
+      }
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if ( seq_.load( std::memory_order_relaxed ) == before ) {
+        break;
+      }
+    }
+
+    T value {};
+    std::memcpy( static_cast<void*>( &value ), words.data(), sizeof( T ) );
+    return value;
+  }
+};
@@ -1,11 +1,13 @@
 #pragma once
 
 #include "address.hh"
+#include "ethernet_header.hh"
 #include "wrapping_integers.hh"
 
 #include <cstddef>
 #include <cstdint>
 #include <optional>
+#include <string>
 
 //! Config for TCP sender and receiver
 class TCPConfig
@@ -13,13 +15,52 @@ class TCPConfig
 public:
   static constexpr size_t DEFAULT_CAPACITY = 64000; //!< Default capacity
   static constexpr size_t MAX_PAYLOAD_SIZE = 1000;  //!< Conservative max payload size for real Internet
+  static constexpr uint16_t DEFAULT_MSS = 1460;     //!< MSS for a 1500-byte MTU (minus 20-byte IP and TCP headers)
+  static constexpr uint16_t DEFAULT_PEER_MSS = 536; //!< MSS to assume when the peer's SYN has no MSS option
+  static constexpr uint16_t MIN_PEER_MSS = 88;      //!< Smallest peer MSS we honour (Linux's TCP_MIN_MSS)
   static constexpr uint16_t TIMEOUT_DFLT = 1000;    //!< Default re-transmit timeout is 1 second
   static constexpr unsigned MAX_RETX_ATTEMPTS = 8;  //!< Maximum re-transmit attempts before giving up
+  static constexpr uint64_t RTO_MIN_MS = 200;       //!< Lower bound of an RTO computed from RTT samples
+  static constexpr uint64_t RTO_MAX_MS = 60 * 1000; //!< Upper bound of an RTO computed from RTT samples
+
+  static constexpr uint16_t MAX_DELAYED_ACK_MS = 40; //!< Longest we hold back an ACK for in-order data
+
+  static constexpr size_t MIN_RECV_CAPACITY = 4096;            //!< Autotuning floor of the receive buffer
+  static constexpr size_t MAX_RECV_CAPACITY = 4 * 1024 * 1024; //!< Autotuning ceiling of the receive buffer
+
+  static constexpr size_t DEFAULT_SYN_BACKLOG = 256;    //!< Default bound on a listener's half-open connections
+  static constexpr size_t DEFAULT_ACCEPT_BACKLOG = 128; //!< Default bound on a listener's unaccepted connections
+  static constexpr unsigned MAX_SYNACK_RETX = 5;        //!< SYN-ACK retransmissions before dropping a half-open one
+  static constexpr uint64_t TIME_WAIT_MS = 60 * 1000;   //!< How long the side that closed first lingers
 
   uint16_t rt_timeout = TIMEOUT_DFLT;      //!< Initial value of the retransmission timeout, in milliseconds
-  size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes
+  size_t recv_capacity = DEFAULT_CAPACITY; //!< Receive capacity, in bytes (the initial one, if autotuning)
   size_t send_capacity = DEFAULT_CAPACITY; //!< Sender capacity, in bytes
+  uint16_t mss = DEFAULT_MSS;              //!< Largest payload we accept (advertised) and send, in bytes
   std::optional<Wrap32> fixed_isn {};
+
+  uint16_t delayed_ack_ms = MAX_DELAYED_ACK_MS; //!< Delayed-ACK timeout (0: ACK every segment at once)
+  size_t recv_capacity_min = MIN_RECV_CAPACITY; //!< Smallest receive capacity autotuning shrinks to
+  size_t recv_capacity_max = MAX_RECV_CAPACITY; //!< Largest receive capacity autotuning grows to
+
+  bool timestamps = true;     //!< Negotiate the RFC 7323 timestamps option (RTT samples and PAWS)
+  bool window_scaling = true; //!< Negotiate RFC 7323 window scaling, so recv_capacity may exceed 64 KiB
+  bool sack = true;           //!< Negotiate RFC 2018 selective acknowledgments
+  bool rack_tlp = true;       //!< RFC 8985 time-based loss detection and tail loss probes in the sender
+  bool recv_autotune = true;  //!< Resize the receive buffer to follow what the application drains per RTT
+
+  bool congestion_control = true; //!< Limit sending by a congestion window (RFC 5681), besides the peer's window
+  bool ecn = true;                //!< Negotiate ECN (RFC 3168): send ECT(0), echo CE marks with ECE, react to ECE
+  bool dctcp = false;             //!< With ECN, cut the window by the fraction of CE-marked bytes (DCTCP, RFC 8257)
+
+  size_t syn_backlog = DEFAULT_SYN_BACKLOG;       //!< Half-open connections a listener holds
+  size_t accept_backlog = DEFAULT_ACCEPT_BACKLOG; //!< Established connections a listener holds until accepted
+
+  bool syn_cookies = true; //!< Answer SYNs statelessly with SYN cookies (RFC 4987) once the SYN queue is full
+  bool fast_open = false;  //!< TCP Fast Open (RFC 7413): clients ask for and present cookies, listeners grant them
+
+  size_t trace_events = 0;   //!< Events kept in the connection's TCPTrace ring (0: no tracing)
+  std::string trace_path {}; //!< Where TCPMinnowSocket dumps the trace, on demand or on a connection error
 };
 
 //! Config for classes derived from FdAdapter
@@ -29,6 +70,8 @@ public:
   Address source { "0", 0 };      //!< Source address and port
   Address destination { "0", 0 }; //!< Destination address and port
 
+  uint16_t mtu = EthernetHeader::DEFAULT_MTU; //!< Largest IP datagram sent (up to EthernetHeader::MAX_MTU)
+
   uint16_t loss_rate_dn = 0; //!< Downlink loss rate (for LossyFdAdapter)
   uint16_t loss_rate_up = 0; //!< Uplink loss rate (for LossyFdAdapter)
 };
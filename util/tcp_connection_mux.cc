@@ -0,0 +1,275 @@
+#include "tcp_connection_mux.hh"
+#include "tcp_over_ip.hh"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+static constexpr size_t TCP_SEND_BATCH = 64; // segments drained from a TCPPeer per maybe_send() call
+
+optional<FastOpenCookieCache::Entry> FastOpenCookieCache::find( const uint32_t server_ip ) const
+{
+  const auto it = entries_.find( server_ip );
+  if ( it == entries_.end() ) {
+    return {};
+  }
+  return it->second;
+}
+
+void FastOpenCookieCache::insert( const uint32_t server_ip, const Entry& entry )
+{
+  if ( entries_.size() >= MAX_ENTRIES and not entries_.contains( server_ip ) ) {
+    entries_.erase( entries_.begin() );
+  }
+  entries_[server_ip] = entry;
+}
+
+TCPConnectionMux::TCPConnectionMux( const size_t expected_connections ) : table_( expected_connections )
+{
+  connections_.reserve( expected_connections );
+}
+
+TCPConnectionMux::Connection& TCPConnectionMux::live( const ConnectionId id )
+{
+  Connection& c = connections_.at( id );
+  if ( not c.peer.has_value() ) {
+    throw runtime_error( "TCPConnectionMux: no connection with id " + to_string( id ) );
+  }
+  return c;
+}
+
+const TCPConnectionMux::Connection& TCPConnectionMux::live( const ConnectionId id ) const
+{
+  const Connection& c = connections_.at( id );
+  if ( not c.peer.has_value() ) {
+    throw runtime_error( "TCPConnectionMux: no connection with id " + to_string( id ) );
+  }
+  return c;
+}
+
+TCPConnectionMux::ConnectionId TCPConnectionMux::add( const FourTuple& tuple, const TCPConfig& config )
+{
+  ConnectionId id = free_list_;
+  if ( id == NONE and connections_.size() >= NONE ) {
+    throw runtime_error( "TCPConnectionMux: too many connections" );
+  }
+  if ( id == NONE ) {
+    id = static_cast<ConnectionId>( connections_.size() );
+  }
+
+  if ( not table_.insert( tuple, id ) ) {
+    throw runtime_error( "TCPConnectionMux: 4-tuple already in use" );
+  }
+
+  if ( id == connections_.size() ) {
+    connections_.emplace_back();
+  } else {
+    free_list_ = connections_[id].next_free;
+  }
+
+  Connection& c = connections_[id];
+  c.peer.emplace( config );
+  c.tuple = tuple;
+  c.clock_ms = wheel_.now();
+  for ( size_t kind = 0; kind < c.timers.size(); kind++ ) {
+    c.timers[kind] = wheel_.add( id, static_cast<TimerWheel::Kind>( kind ) );
+  }
+  c.time_wait = false;
+  c.finished = false;
+  c.next_free = NONE;
+  return id;
+}
+
+TCPConnectionMux::ConnectionId TCPConnectionMux::connect( const FourTuple& tuple,
+                                                          const TCPConfig& config,
+                                                          const string_view first_data )
+{
+  const ConnectionId id = add( tuple, config );
+  TCPPeer& p = peer( id );
+  if ( config.fast_open ) {
+    const auto cached = fast_open_cache_.find( tuple.remote_ip );
+    if ( cached.has_value() ) {
+      p.fast_open( cached->cookie, cached->mss );
+    } else {
+      p.fast_open( {}, TCPConfig::DEFAULT_PEER_MSS );
+    }
+  }
+  p.outbound_writer().push( string( first_data ) );
+  p.push();
+  mark_ready( id );
+  return id;
+}
+
+void TCPConnectionMux::remove( const ConnectionId id )
+{
+  Connection& c = live( id );
+  table_.erase( c.tuple );
+  for ( const auto timer : c.timers ) {
+    wheel_.remove( timer );
+  }
+  c.peer.reset();
+  c.finished = false;
+  c.next_free = free_list_;
+  free_list_ = id;
+  // a pending (or finished) entry stays on its list; collect() and remove_inactive() skip it (or serve
+  // whoever reuses the id)
+}
+
+optional<TCPConnectionMux::ConnectionId> TCPConnectionMux::find( const FourTuple& tuple ) const
+{
+  const ConnectionId id = table_.find( tuple );
+  if ( id == NONE ) {
+    return {};
+  }
+  return id;
+}
+
+TCPPeer& TCPConnectionMux::catch_up( Connection& c )
+{
+  TCPPeer& p = c.peer.value();
+  if ( c.clock_ms < wheel_.now() and p.active() ) {
+    p.tick( wheel_.now() - c.clock_ms );
+  }
+  c.clock_ms = wheel_.now();
+  return p;
+}
+
+void TCPConnectionMux::set_timer( Connection& c, const TimerWheel::Kind kind, const optional<uint64_t> delay_ms )
+{
+  const auto timer = c.timers[static_cast<size_t>( kind )];
+  if ( not delay_ms.has_value() ) {
+    wheel_.cancel( timer );
+    return;
+  }
+  // Leave a timer that is already right alone, rather than move it to the front of its slot
+  const uint64_t expiry = wheel_.now() + max<uint64_t>( delay_ms.value(), 1 );
+  if ( not wheel_.armed( timer ) or wheel_.expiry( timer ) != expiry ) {
+    wheel_.arm( timer, delay_ms.value() );
+  }
+}
+
+void TCPConnectionMux::schedule( Connection& c )
+{
+  const TCPPeer& p = catch_up( c );
+  const auto rto = p.retransmission_timer_ms();
+  const bool persist = p.sender().probing_zero_window();
+  set_timer( c, TimerWheel::Kind::Retransmission, persist ? nullopt : rto );
+  set_timer( c, TimerWheel::Kind::Persist, persist ? rto : nullopt );
+  set_timer( c, TimerWheel::Kind::DelayedAck, p.delayed_ack_timer_ms() );
+  set_timer( c, TimerWheel::Kind::LossDetection, p.loss_detection_timer_ms() );
+
+  if ( not c.time_wait and not p.active() and p.lingers() ) {
+    c.time_wait = true;
+    set_timer( c, TimerWheel::Kind::TimeWait, TCPConfig::TIME_WAIT_MS );
+  }
+}
+
+void TCPConnectionMux::mark_ready( const ConnectionId id )
+{
+  Connection& c = live( id );
+  if ( not c.pending ) {
+    c.pending = true;
+    pending_.push_back( id );
+  }
+}
+
+void TCPConnectionMux::deliver( const ConnectionId id, TCPSegment seg )
+{
+  TCPPeer& p = peer( id );
+  p.receive( move( seg ) );
+  if ( auto cookie = p.take_fast_open_cookie() ) {
+    fast_open_cache_.insert( tuple( id ).remote_ip, { cookie.value(), p.peer_mss() } );
+  }
+  mark_ready( id );
+}
+
+optional<TCPConnectionMux::ConnectionId> TCPConnectionMux::receive( const InternetDatagram& dgram )
+{
+  auto seg = parse_tcp_in_ip( dgram );
+  if ( not seg.has_value() ) {
+    return {};
+  }
+
+  const auto id = find( arriving_four_tuple( dgram, seg.value() ) );
+  if ( id.has_value() ) {
+    deliver( id.value(), move( seg.value() ) );
+  }
+  return id;
+}
+
+size_t TCPConnectionMux::receive( span<const InternetDatagram> dgrams )
+{
+  // Parse the whole burst first, so that the table lookups can be issued together
+  parsed_.clear();
+  keys_.clear();
+  for ( const auto& dgram : dgrams ) {
+    parsed_.push_back( parse_tcp_in_ip( dgram ) );
+    keys_.push_back( parsed_.back().has_value() ? arriving_four_tuple( dgram, parsed_.back().value() )
+                                                : FourTuple {} );
+  }
+
+  ids_.resize( keys_.size() );
+  table_.find_batch( keys_, ids_ );
+
+  size_t delivered = 0;
+  for ( size_t i = 0; i < parsed_.size(); i++ ) {
+    if ( parsed_[i].has_value() and ids_[i] != NONE ) {
+      deliver( ids_[i], move( parsed_[i].value() ) );
+      delivered++;
+    }
+  }
+  return delivered;
+}
+
+void TCPConnectionMux::tick( const uint64_t ms_since_last_tick )
+{
+  // A timer that fires is re-armed by the collect() that follows, so each fires at most once per tick(). An
+  // expired TIME_WAIT has nothing to send, but the collect() retires the connection.
+  wheel_.advance( ms_since_last_tick, [&]( TimerWheel::TimerId, uint64_t owner, TimerWheel::Kind ) {
+    const auto id = static_cast<ConnectionId>( owner );
+    catch_up( connections_[id] );
+    mark_ready( id );
+  } );
+}
+
+void TCPConnectionMux::collect( vector<InternetDatagram>& out )
+{
+  for ( const ConnectionId id : pending_ ) {
+    Connection& c = connections_[id];
+    c.pending = false;
+    if ( not c.peer.has_value() ) {
+      continue;
+    }
+
+    segments_.clear();
+    TCPPeer& p = catch_up( c );
+    while ( p.maybe_send( segments_, TCP_SEND_BATCH ) == TCP_SEND_BATCH ) {}
+    for ( auto& seg : segments_ ) {
+      out.push_back( wrap_tcp_in_ip( seg, c.tuple ) );
+    }
+    schedule( c );
+
+    // One that closed first is done once its TIME_WAIT timer fires (and tick() marks it ready)
+    const auto time_wait = c.timers[static_cast<size_t>( TimerWheel::Kind::TimeWait )];
+    if ( not c.finished and not p.active() and not wheel_.armed( time_wait ) ) {
+      c.finished = true;
+      finished_.push_back( id );
+    }
+  }
+  pending_.clear();
+}
+
+size_t TCPConnectionMux::remove_inactive()
+{
+  size_t removed = 0;
+  for ( const ConnectionId id : finished_ ) {
+    if ( connections_[id].finished ) {
+      remove( id );
+      removed++;
+    }
+  }
+  finished_.clear();
+  return removed;
+}
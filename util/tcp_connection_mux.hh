@@ -0,0 +1,157 @@
+#pragma once
+
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection_table.hh"
+#include "tcp_peer.hh"
+#include "tcp_segment.hh"
+#include "timer_wheel.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// TCP Fast Open cookies that servers have granted, by server address, with the MSS each server announced
+class FastOpenCookieCache
+{
+public:
+  static constexpr size_t MAX_ENTRIES = 4096;
+
+  struct Entry
+  {
+    TCPOptions::FastOpenCookie cookie {};
+    size_t mss {};
+  };
+
+private:
+  std::unordered_map<uint32_t, Entry> entries_ {};
+
+public:
+  std::optional<Entry> find( uint32_t server_ip ) const;
+
+  // Remember a cookie (replacing any older one), evicting an arbitrary entry when full
+  void insert( uint32_t server_ip, const Entry& entry );
+
+  size_t size() const { return entries_.size(); }
+};
+
+// Many TCP connections over one datagram adapter.
+//
+// Each connection is a TCPPeer and the 4-tuple that identifies it. Arriving IPv4 datagrams are matched to
+// their connection through a TCPConnectionTable, and the segments the connections send are wrapped in
+// datagrams addressed from their 4-tuples, so a single TUN device (or any other source of datagrams) and a
+// single event loop can serve thousands of connections. The mux does no I/O of its own: the caller reads
+// datagrams into receive(), writes out what collect() produces, and calls tick() as time passes.
+//
+// The connections' timers (retransmission or zero-window probe, delayed ACK, RACK-TLP loss detection and
+// TIME_WAIT) live on one TimerWheel, re-armed from each connection's deadlines whenever collect() visits
+// it. tick() only turns the wheel, and ticks just the connections whose timers expire; the others catch up
+// with the mux's clock lazily, the next time they are touched.
+//
+// Connection ids are small integers, stable for the life of the connection, and reused after remove().
+class TCPConnectionMux
+{
+public:
+  using ConnectionId = uint32_t;
+  static constexpr ConnectionId NONE = TCPConnectionTable::NONE;
+
+private:
+  struct Connection
+  {
+    std::optional<TCPPeer> peer {};
+    FourTuple tuple {};
+    // The connection's timers on wheel_, indexed by TimerWheel::Kind
+    std::array<TimerWheel::TimerId, TimerWheel::KINDS> timers {};
+    uint64_t clock_ms {};            // mux time the peer has been ticked up to
+    bool time_wait {};               // closed first, and has started lingering in TIME_WAIT
+    bool pending {};                 // may have segments to send (on the pending_ list)
+    bool finished {};                // done, and not lingering (on the finished_ list)
+    ConnectionId next_free { NONE }; // free-list link while the slot is unused
+  };
+
+  std::vector<Connection> connections_ {};
+  ConnectionId free_list_ { NONE };
+  TCPConnectionTable table_;
+  TimerWheel wheel_ {};
+
+  // Connections touched since the last collect(), so collect() need not visit idle ones
+  std::vector<ConnectionId> pending_ {};
+
+  // Connections collect() found done (and not lingering), for remove_inactive() to remove
+  std::vector<ConnectionId> finished_ {};
+
+  // Scratch space reused across calls
+  std::vector<TCPSegment> segments_ {};
+  std::vector<std::optional<TCPSegment>> parsed_ {};
+  std::vector<FourTuple> keys_ {};
+  std::vector<ConnectionId> ids_ {};
+
+  // Cookies granted to our Fast Open connections
+  FastOpenCookieCache fast_open_cache_ {};
+
+  Connection& live( ConnectionId id );
+  const Connection& live( ConnectionId id ) const;
+
+  // Hand an arriving segment to connection `id`, and keep any Fast Open cookie it grants
+  void deliver( ConnectionId id, TCPSegment seg );
+
+  // Tick a connection's peer up to the mux's clock
+  TCPPeer& catch_up( Connection& c );
+
+  // Re-arm a connection's timers from its peer's deadlines (and start TIME_WAIT once it has closed first)
+  void schedule( Connection& c );
+  void set_timer( Connection& c, TimerWheel::Kind kind, std::optional<uint64_t> delay_ms );
+
+public:
+  explicit TCPConnectionMux( size_t expected_connections = 0 );
+
+  // Add a connection that will wait for the peer's SYN; throws if the 4-tuple is already in use
+  ConnectionId add( const FourTuple& tuple, const TCPConfig& config );
+
+  // Add a connection, queue `first_data` for it, and start connecting (its SYN goes out with the next
+  // collect()). With config.fast_open and a cookie cached for the server, the SYN carries the data.
+  ConnectionId connect( const FourTuple& tuple, const TCPConfig& config, std::string_view first_data = {} );
+
+  // Forget a connection immediately, without sending anything
+  void remove( ConnectionId id );
+
+  std::optional<ConnectionId> find( const FourTuple& tuple ) const;
+
+  // A connection's peer, brought up to the mux's clock. After changing its state (e.g. writing to its
+  // outbound stream), call mark_ready() so that collect() sends what is due and re-arms its timers.
+  TCPPeer& peer( ConnectionId id ) { return catch_up( live( id ) ); }
+  const TCPPeer& peer( ConnectionId id ) const { return live( id ).peer.value(); }
+  const FourTuple& tuple( ConnectionId id ) const { return live( id ).tuple; }
+
+  // Have collect() look at this connection, e.g. after the application wrote to its outbound stream
+  void mark_ready( ConnectionId id );
+
+  size_t size() const { return table_.size(); }
+  const FastOpenCookieCache& fast_open_cache() const { return fast_open_cache_; }
+
+  // Give an arriving datagram to the connection it belongs to. Returns that connection, or empty if the
+  // datagram carried no valid TCP segment or matched no connection.
+  std::optional<ConnectionId> receive( const InternetDatagram& dgram );
+
+  // Same, for a burst of datagrams (whose connections are looked up together); returns how many were
+  // delivered
+  size_t receive( std::span<const InternetDatagram> dgrams );
+
+  // Move the mux's clock forward, ticking (and marking ready) only the connections whose timers expire
+  void tick( uint64_t ms_since_last_tick );
+
+  // Append the datagrams that the connections touched since the last call have ready to send
+  void collect( std::vector<InternetDatagram>& out );
+
+  // Remove connections that have finished (or been reset) and are not lingering in TIME_WAIT, as of the
+  // last collect(); returns how many were removed
+  size_t remove_inactive();
+
+  // Connections marked ready for the next collect(); testing interface
+  size_t pending_size() const { return pending_.size(); }
+};
@@ -0,0 +1,115 @@
+#include "tcp_connection_table.hh"
+#include "random.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+static constexpr size_t MIN_SLOTS = 16;
+static constexpr size_t BATCH = 16; // lookups whose cache lines find_batch() fetches together
+
+namespace {
+
+// Slots needed to hold `n` entries at a load factor of at most 3/4
+size_t slots_for( size_t n )
+{
+  return bit_ceil( max( MIN_SLOTS, n + n / 3 + 1 ) );
+}
+
+} // namespace
+
+TCPConnectionTable::TCPConnectionTable( const size_t expected_size )
+{
+  auto rd = get_random_engine();
+  seed_ = mix64( static_cast<uint64_t>( rd() ) << 32 ^ rd() );
+  slots_.resize( slots_for( expected_size ) );
+  mask_ = slots_.size() - 1;
+}
+
+uint64_t TCPConnectionTable::hash( const FourTuple& key ) const
+{
+  const uint64_t ips = static_cast<uint64_t>( key.local_ip ) << 32 | key.remote_ip;
+  const uint64_t ports = static_cast<uint64_t>( key.local_port ) << 16 | key.remote_port;
+  return mix64( mix64( ips ^ seed_ ) ^ ports );
+}
+
+size_t TCPConnectionTable::probe( const FourTuple& key, size_t index ) const
+{
+  while ( slots_[index].value != NONE and not( slots_[index].key == key ) ) {
+    index = ( index + 1 ) & mask_;
+  }
+  return index;
+}
+
+void TCPConnectionTable::rehash( const size_t new_slot_count )
+{
+  vector<Slot> old( new_slot_count );
+  swap( old, slots_ );
+  mask_ = slots_.size() - 1;
+  for ( const auto& slot : old ) {
+    if ( slot.value != NONE ) {
+      slots_[probe( slot.key, home( slot.key ) )] = slot;
+    }
+  }
+}
+
+bool TCPConnectionTable::insert( const FourTuple& key, const Value value )
+{
+  if ( value == NONE ) {
+    throw runtime_error( "TCPConnectionTable: NONE cannot be stored" );
+  }
+  if ( slots_for( size_ + 1 ) > slots_.size() ) {
+    rehash( slots_.size() * 2 );
+  }
+
+  Slot& slot = slots_[probe( key, home( key ) )];
+  if ( slot.value != NONE ) {
+    return false;
+  }
+  slot = Slot { key, value };
+  size_++;
+  return true;
+}
+
+void TCPConnectionTable::find_batch( span<const FourTuple> keys, span<Value> values ) const
+{
+  if ( values.size() < keys.size() ) {
+    throw runtime_error( "TCPConnectionTable::find_batch: too few values for the keys" );
+  }
+
+  array<size_t, BATCH> homes {};
+  for ( size_t start = 0; start < keys.size(); start += BATCH ) {
+    const size_t count = min( BATCH, keys.size() - start );
+    for ( size_t i = 0; i < count; i++ ) {
+      homes[i] = home( keys[start + i] );
+      __builtin_prefetch( &slots_[homes[i]] );
+    }
+    for ( size_t i = 0; i < count; i++ ) {
+      values[start + i] = slots_[probe( keys[start + i], homes[i] )].value;
+    }
+  }
+}
+
+bool TCPConnectionTable::erase( const FourTuple& key )
+{
+  size_t hole = probe( key, home( key ) );
+  if ( slots_[hole].value == NONE ) {
+    return false;
+  }
+
+  // Shift back every later member of the run that may live at or before the hole
+  for ( size_t next = ( hole + 1 ) & mask_; slots_[next].value != NONE; next = ( next + 1 ) & mask_ ) {
+    const size_t want = home( slots_[next].key );
+    const bool stays = hole < next ? ( hole < want and want <= next ) : ( hole < want or want <= next );
+    if ( not stays ) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+  slots_[hole] = Slot {};
+  size_--;
+  return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// The addresses and ports that identify a TCP connection, as seen from our end
+struct FourTuple
+{
+  uint32_t local_ip {};
+  uint32_t remote_ip {};
+  uint16_t local_port {};
+  uint16_t remote_port {};
+
+  bool operator==( const FourTuple& other ) const = default;
+};
+
+// A map from connection 4-tuples to connection ids, for demultiplexing arriving segments among many
+// connections that share one datagram adapter.
+//
+// The table is open-addressed with linear probing: each slot holds the key and its value side by side in
+// 16 bytes, four to a cache line, so a lookup usually touches a single line and never chases a pointer.
+// Erasing shifts later members of the probe run back instead of leaving tombstones, so lookups stay short
+// under connection churn. The hash is keyed with a per-table random seed, so that a peer choosing its
+// addresses and ports cannot force long probe runs.
+//
+// find_batch() looks up many keys at once, prefetching each key's slot a few keys ahead of probing it, so
+// that the cache misses of a burst of arriving segments overlap instead of being paid one after another.
+class TCPConnectionTable
+{
+public:
+  using Value = uint32_t;
+  static constexpr Value NONE = UINT32_MAX;
+
+private:
+  struct alignas( 16 ) Slot
+  {
+    FourTuple key {};
+    Value value { NONE }; // NONE marks an empty slot
+  };
+
+  std::vector<Slot> slots_ {};
+  uint64_t mask_ {};
+  size_t size_ {};
+  uint64_t seed_ {};
+
+  uint64_t hash( const FourTuple& key ) const;
+  size_t home( const FourTuple& key ) const { return hash( key ) & mask_; }
+
+  // Find the slot holding `key`, or the empty slot that ends its probe run
+  size_t probe( const FourTuple& key, size_t index ) const;
+
+  void rehash( size_t new_slot_count );
+
+public:
+  explicit TCPConnectionTable( size_t expected_size = 0 );
+
+  // Map `key` to `value`; returns false (and changes nothing) if `key` is already present
+  bool insert( const FourTuple& key, Value value );
+
+  // The value mapped to `key`, or NONE
+  Value find( const FourTuple& key ) const { return slots_[probe( key, home( key ) )].value; }
+
+  // Look up every key in `keys`, writing the results (or NONE) to the same positions of `values`
+  void find_batch( std::span<const FourTuple> keys, std::span<Value> values ) const;
+
+  // Start fetching the cache line that a lookup of `key` will begin with
+  void prefetch( const FourTuple& key ) const { __builtin_prefetch( &slots_[home( key )] ); }
+
+  // Remove `key`; returns false if it was not present
+  bool erase( const FourTuple& key );
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+};
@@ -0,0 +1,263 @@
+#include "tcp_listener.hh"
+#include "random.hh"
+#include "tcp_over_ip.hh"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+
+using namespace std;
+
+// A cookie's timestamp counts periods of 64 s in five bits; a cookie is good for the period it was sent
+// in and the next one
+static constexpr uint64_t COOKIE_PERIOD_MS = 64 * 1000;
+static constexpr uint64_t COOKIE_COUNT_MASK = 31;
+
+// The peer MSS a cookie can remember, rounded down to one of these (three bits)
+static constexpr array<uint16_t, 8> COOKIE_MSS = { 216, 536, 1024, 1200, 1300, 1400, 1440, 1460 };
+
+namespace {
+
+uint32_t raw( Wrap32 seqno )
+{
+  return static_cast<uint32_t>( seqno.unwrap( Wrap32 { 0 }, 0 ) );
+}
+
+} // namespace
+
+TCPListener::TCPListener( TCPConnectionMux& mux, const uint16_t port, const TCPConfig& cfg )
+  : mux_( mux ), cfg_( cfg ), port_( port )
+{
+  auto rd = get_random_engine();
+  cookie_secret_ = mix64( static_cast<uint64_t>( rd() ) << 32 ^ rd() );
+  fast_open_secret_ = mix64( static_cast<uint64_t>( rd() ) << 32 ^ rd() );
+}
+
+bool TCPListener::established( const TCPConnectionMux::ConnectionId id ) const
+{
+  const TCPPeer& peer = mux_.peer( id );
+  return peer.active() and peer.has_ackno() and peer.sender().sequence_numbers_in_flight() == 0;
+}
+
+void TCPListener::admit( const TCPConnectionMux::ConnectionId id )
+{
+  if ( accept_queue_.size() >= cfg_.accept_backlog ) {
+    return;
+  }
+  const auto it = ranges::find( syn_queue_, id );
+  *it = syn_queue_.back();
+  syn_queue_.pop_back();
+  half_open_[id] = false;
+  accept_queue_.push_back( id );
+}
+
+void TCPListener::drop_half_open( const size_t index )
+{
+  const auto id = syn_queue_[index];
+  half_open_[id] = false;
+  mux_.remove( id );
+  syn_queue_[index] = syn_queue_.back();
+  syn_queue_.pop_back();
+}
+
+void TCPListener::receive( const InternetDatagram& dgram )
+{
+  const auto id = mux_.receive( dgram );
+  if ( not id.has_value() ) {
+    receive_unmatched( dgram );
+    return;
+  }
+
+  // Did that complete (or reset) a handshake?
+  if ( id.value() < half_open_.size() and half_open_[id.value()] ) {
+    if ( not mux_.peer( id.value() ).active() ) {
+      drop_half_open( ranges::find( syn_queue_, id.value() ) - syn_queue_.begin() );
+    } else if ( established( id.value() ) ) {
+      admit( id.value() );
+    }
+  }
+}
+
+void TCPListener::receive_unmatched( const InternetDatagram& dgram )
+{
+  auto seg = parse_tcp_in_ip( dgram );
+  if ( not seg.has_value() or seg->udinfo.dst_port != port_ or seg->reset ) {
+    return;
+  }
+  const FourTuple tuple = arriving_four_tuple( dgram, seg.value() );
+
+  const bool syn = seg->sender_message.SYN and not seg->receiver_message.ackno.has_value();
+  if ( not syn ) {
+    if ( cfg_.syn_cookies and not seg->sender_message.SYN and seg->receiver_message.ackno.has_value() ) {
+      accept_cookie( tuple, move( seg.value() ) );
+    }
+    return;
+  }
+
+  // Like Linux, take no new connections while the application is not accepting the ones it has
+  if ( accept_queue_.size() >= cfg_.accept_backlog ) {
+    syns_dropped_++;
+    return;
+  }
+
+  if ( syn_queue_.size() < cfg_.syn_backlog ) {
+    const auto id = mux_.add( tuple, cfg_ );
+    TCPPeer& peer = mux_.peer( id );
+    const bool fast_open = check_fast_open( tuple, seg.value(), peer );
+    peer.receive( move( seg.value() ) );
+    mux_.mark_ready( id );
+
+    // A Fast Open connection is ready for the application before its handshake completes
+    if ( fast_open ) {
+      accept_queue_.push_back( id );
+      fast_opens_++;
+      return;
+    }
+    syn_queue_.push_back( id );
+    if ( half_open_.size() <= id ) {
+      half_open_.resize( id + 1 );
+    }
+    half_open_[id] = true;
+  } else if ( cfg_.syn_cookies ) {
+    send_cookie( tuple, seg.value() );
+  } else {
+    syns_dropped_++;
+  }
+}
+
+//! \details Cookie layout (RFC 4987): 5 bits of timestamp counter, 3 bits of MSS index, and 24 bits of a
+//! keyed hash of the 4-tuple, the peer's ISN, the counter and the MSS index
+uint32_t TCPListener::cookie( const FourTuple& tuple,
+                              const uint32_t their_isn,
+                              const uint64_t count,
+                              const unsigned mss_index ) const
+{
+  const uint64_t ips = static_cast<uint64_t>( tuple.local_ip ) << 32 | tuple.remote_ip;
+  const uint64_t ports = static_cast<uint64_t>( tuple.local_port ) << 16 | tuple.remote_port;
+  const uint64_t ports_isn = ports << 32 | their_isn;
+  const uint64_t h = mix64( mix64( mix64( cookie_secret_ ^ ips ) ^ ports_isn ) ^ ( count << 3 | mss_index ) );
+  return static_cast<uint32_t>( ( count & COOKIE_COUNT_MASK ) << 27 | mss_index << 24 | ( h & 0xff'ffff ) );
+}
+
+TCPOptions::FastOpenCookie TCPListener::fast_open_cookie( const uint32_t client_ip ) const
+{
+  const uint64_t h = mix64( fast_open_secret_ ^ client_ip );
+  TCPOptions::FastOpenCookie cookie;
+  cookie.length = sizeof( h );
+  for ( size_t i = 0; i < sizeof( h ); i++ ) {
+    cookie.bytes[i] = static_cast<uint8_t>( h >> ( 8 * i ) );
+  }
+  return cookie;
+}
+
+bool TCPListener::check_fast_open( const FourTuple& tuple, TCPSegment& syn, TCPPeer& peer ) const
+{
+  const auto& presented = syn.options.fast_open;
+  const bool valid = cfg_.fast_open and presented.has_value()
+                     and presented.value() == fast_open_cookie( tuple.remote_ip );
+  if ( cfg_.fast_open and presented.has_value() and not valid ) {
+    peer.grant_fast_open_cookie( fast_open_cookie( tuple.remote_ip ) );
+  }
+  if ( not valid ) {
+    syn.sender_message.payload = Buffer {};
+    syn.sender_message.FIN = false;
+  }
+  return valid and syn.sender_message.payload.size() > 0;
+}
+
+void TCPListener::send_cookie( const FourTuple& tuple, const TCPSegment& syn )
+{
+  const uint16_t their_mss = syn.options.mss.value_or( TCPConfig::DEFAULT_PEER_MSS );
+  unsigned mss_index = 0;
+  while ( mss_index + 1 < COOKIE_MSS.size() and COOKIE_MSS[mss_index + 1] <= their_mss ) {
+    mss_index++;
+  }
+
+  TCPSegment synack;
+  synack.sender_message.seqno
+    = Wrap32 { cookie( tuple, raw( syn.sender_message.seqno ), now_ms_ / COOKIE_PERIOD_MS, mss_index ) };
+  synack.sender_message.SYN = true;
+  synack.receiver_message.ackno = syn.sender_message.seqno + 1;
+  synack.receiver_message.window_size = static_cast<uint16_t>( min<size_t>( cfg_.recv_capacity, UINT16_MAX ) );
+  synack.options.mss = cfg_.mss;
+  replies_.push_back( wrap_tcp_in_ip( synack, tuple ) );
+  cookies_sent_++;
+}
+
+void TCPListener::accept_cookie( const FourTuple& tuple, TCPSegment ack )
+{
+  if ( accept_queue_.size() >= cfg_.accept_backlog ) {
+    return;
+  }
+
+  const uint32_t value = raw( ack.receiver_message.ackno.value() ) - 1;
+  const uint32_t their_isn = raw( ack.sender_message.seqno ) - 1;
+  const uint64_t count = now_ms_ / COOKIE_PERIOD_MS;
+  const uint64_t age = ( count - ( value >> 27 ) ) & COOKIE_COUNT_MASK;
+  const unsigned mss_index = ( value >> 24 ) & 7;
+  if ( age > 1 or count < age or cookie( tuple, their_isn, count - age, mss_index ) != value ) {
+    return;
+  }
+
+  // Rebuild the connection as the SYN would have left it: replay a SYN carrying the remembered MSS, and
+  // let the peer regenerate (into the void) the SYN-ACK that the cookie already answered it with
+  TCPConfig cfg = cfg_;
+  cfg.fixed_isn = Wrap32 { value };
+  const auto id = mux_.add( tuple, cfg );
+  TCPPeer& peer = mux_.peer( id );
+
+  TCPSegment syn;
+  syn.sender_message.seqno = Wrap32 { their_isn };
+  syn.sender_message.SYN = true;
+  syn.receiver_message.window_size = ack.receiver_message.window_size;
+  syn.options.mss = COOKIE_MSS[mss_index];
+  peer.receive( move( syn ) );
+  vector<TCPSegment> synack;
+  peer.maybe_send( synack, 1 );
+
+  peer.receive( move( ack ) );
+  mux_.mark_ready( id );
+  accept_queue_.push_back( id );
+  cookies_accepted_++;
+}
+
+void TCPListener::tick( const uint64_t ms_since_last_tick )
+{
+  now_ms_ += ms_since_last_tick;
+
+  // Going backwards, so what drop_half_open() and admit() move into a visited slot has been visited
+  for ( size_t i = syn_queue_.size(); i > 0; i-- ) {
+    const auto id = syn_queue_[i - 1];
+    const TCPPeer& peer = mux_.peer( id );
+    if ( not peer.active() or peer.sender().consecutive_retransmissions() > TCPConfig::MAX_SYNACK_RETX ) {
+      drop_half_open( i - 1 );
+    } else if ( established( id ) ) {
+      admit( id );
+    }
+  }
+}
+
+void TCPListener::collect( vector<InternetDatagram>& out )
+{
+  ranges::move( replies_, back_inserter( out ) );
+  replies_.clear();
+}
+
+optional<TCPConnectionMux::ConnectionId> TCPListener::accept()
+{
+  // Established connections may have been waiting for room in the accept queue
+  if ( accept_queue_.empty() ) {
+    for ( size_t i = syn_queue_.size(); i > 0; i-- ) {
+      if ( established( syn_queue_[i - 1] ) ) {
+        admit( syn_queue_[i - 1] );
+      }
+    }
+  }
+
+  if ( accept_queue_.empty() ) {
+    return {};
+  }
+  const auto id = accept_queue_.front();
+  accept_queue_.pop_front();
+  return id;
+}
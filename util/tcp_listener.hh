@@ -0,0 +1,98 @@
+#pragma once
+
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection_mux.hh"
+#include "tcp_segment.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+// A listening TCP port on a TCPConnectionMux.
+//
+// An arriving SYN for the port creates a TCPPeer in the mux, which answers it with a SYN-ACK. Until the
+// handshake completes the connection sits in the SYN queue (at most cfg.syn_backlog of them, each dropped
+// after TCPConfig::MAX_SYNACK_RETX unanswered SYN-ACKs); then it moves to the accept queue, where accept()
+// hands it out. While the accept queue is full (cfg.accept_backlog), new SYNs are dropped.
+//
+// When the SYN queue is full, SYNs are answered statelessly with SYN cookies (RFC 4987): the ISN of the
+// SYN-ACK encodes a coarse timestamp, the peer's MSS (to one of eight values) and a keyed hash of the
+// 4-tuple and the peer's ISN, so a flood of SYNs costs no memory. An ACK that returns a valid cookie
+// creates the connection then. Such connections go without the options the SYN carried beyond its MSS
+// (timestamps, window scaling, SACK and ECN), as there is nowhere to keep them.
+//
+// With cfg.fast_open, the listener grants TCP Fast Open cookies (RFC 7413) to clients that ask for one: a
+// keyed hash of the client's address. A SYN presenting a valid cookie has its data accepted at once, and
+// its connection goes straight to the accept queue, so the server can answer within the first round trip.
+// Data on any other SYN is dropped (its client sends it again after the handshake).
+//
+// The listener is the front door of the mux for arriving datagrams: receive() passes each one to its
+// connection, and looks at those that match no connection itself. Outgoing datagrams of the listener's
+// own (the cookie SYN-ACKs) are appended by collect(), besides what the mux's collect() produces.
+class TCPListener
+{
+  TCPConnectionMux& mux_;
+  TCPConfig cfg_;
+  uint16_t port_;
+
+  uint64_t now_ms_ {};
+  uint64_t cookie_secret_ {};
+  uint64_t fast_open_secret_ {};
+
+  // Half-open connections, and a flag per connection id for telling them apart on arrival
+  std::vector<TCPConnectionMux::ConnectionId> syn_queue_ {};
+  std::vector<bool> half_open_ {};
+
+  // Established connections waiting for accept(); those beyond the backlog wait in the SYN queue
+  std::deque<TCPConnectionMux::ConnectionId> accept_queue_ {};
+
+  std::vector<InternetDatagram> replies_ {};
+
+  uint64_t cookies_sent_ {};
+  uint64_t cookies_accepted_ {};
+  uint64_t syns_dropped_ {};
+  uint64_t fast_opens_ {};
+
+  bool established( TCPConnectionMux::ConnectionId id ) const;
+  void admit( TCPConnectionMux::ConnectionId id ); // leave the SYN queue for the accept queue, if there is room
+  void drop_half_open( size_t index );             // forget syn_queue_[index] and its connection
+
+  void receive_unmatched( const InternetDatagram& dgram );
+  void send_cookie( const FourTuple& tuple, const TCPSegment& syn );
+  void accept_cookie( const FourTuple& tuple, TCPSegment ack );
+
+  uint32_t cookie( const FourTuple& tuple, uint32_t their_isn, uint64_t count, unsigned mss_index ) const;
+
+  TCPOptions::FastOpenCookie fast_open_cookie( uint32_t client_ip ) const;
+
+  // Keep a SYN's data only if it presented a valid Fast Open cookie (returns whether it did, with data);
+  // grant a cookie to a client that asked for one, or presented a stale one
+  bool check_fast_open( const FourTuple& tuple, TCPSegment& syn, TCPPeer& peer ) const;
+
+public:
+  // Listen on `port` (at any local address of the mux's adapter), with connections configured by `cfg`
+  TCPListener( TCPConnectionMux& mux, uint16_t port, const TCPConfig& cfg );
+
+  // Give an arriving datagram to its connection, or handle it here if it is for our port and no connection
+  void receive( const InternetDatagram& dgram );
+
+  // Tell the listener that time has passed (the mux's tick() is separate)
+  void tick( uint64_t ms_since_last_tick );
+
+  // Append the datagrams the listener has ready to send (the mux's collect() is separate)
+  void collect( std::vector<InternetDatagram>& out );
+
+  // The next established connection, if any; it now belongs to the caller, who removes it from the mux
+  std::optional<TCPConnectionMux::ConnectionId> accept();
+
+  uint16_t port() const { return port_; }
+  size_t syn_queue_size() const { return syn_queue_.size(); }
+  size_t accept_queue_size() const { return accept_queue_.size(); }
+  uint64_t cookies_sent() const { return cookies_sent_; }
+  uint64_t cookies_accepted() const { return cookies_accepted_; }
+  uint64_t syns_dropped() const { return syns_dropped_; }
+  uint64_t fast_opens() const { return fast_opens_; }
+};
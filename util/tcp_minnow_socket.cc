@@ -19,6 +19,7 @@
 using namespace std;
 
 static constexpr size_t TCP_TICK_MS = 10;
+static constexpr size_t TCP_SEND_BATCH = 64; // segments drained from the TCPPeer per maybe_send() call
 
 static inline uint64_t timestamp_ms()
 {
@@ -27,6 +28,15 @@ static inline uint64_t timestamp_ms()
   return std::chrono::steady_clock::now().time_since_epoch().count() / 1000000;
 }
 
+//! The TCP configuration to use over an adapter: the MSS may not exceed what fits in one datagram
+TCPConfig fit_to_mtu( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad )
+{
+  TCPConfig config = c_tcp;
+  const size_t max_mss = c_ad.mtu - IPv4Header::LENGTH - TCPSegment::MIN_HEADER_LENGTH;
+  config.mss = static_cast<uint16_t>( min<size_t>( config.mss, max_mss ) );
+  return config;
+}
+
 //! while condition, wait for next eventloop event to send TCPSegment(contains a send and a recv msg)
 //! \param[in] condition is a function returning true if loop should continue
 template<typename AdaptT>
@@ -43,6 +53,10 @@ void TCPMinnowSocket<AdaptT>::_tcp_loop( const function<bool()>& condition )
       throw runtime_error( "_tcp_loop entered before TCPPeer initialized" );
     }
 
+    if ( _dump_trace.exchange( false ) ) {
+      save_trace();
+    }
+
     if ( _tcp.value().active() ) {
       const auto next_time = timestamp_ms();
       _tcp.value().tick( next_time - base_time );
@@ -70,6 +84,7 @@ template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
 {
   _tcp.emplace( config );
+  _trace_path = config.trace_path;
 
   // Set up the event loop
 
@@ -179,10 +194,8 @@ void TCPMinnowSocket<AdaptT>::_initialize_TCP( const TCPConfig& config )
     _datagram_adapter.fd(),
     Direction::Out,
     [&] {
-      while ( not outgoing_segments_.empty() ) {
-        _datagram_adapter.write( outgoing_segments_.front() );
-        outgoing_segments_.pop();
-      }
+      _datagram_adapter.write( outgoing_segments_ );
+      outgoing_segments_.clear();
     },
     [&] { return not outgoing_segments_.empty(); } );
 }
@@ -238,9 +251,9 @@ void TCPMinnowSocket<AdaptT>::connect( const TCPConfig& c_tcp, const FdAdapterCo
     throw runtime_error( "connect() with TCPConnection already initialized" );
   }
 
-  _initialize_TCP( c_tcp );
+  _initialize_TCP( fit_to_mtu( c_tcp, c_ad ) );
 
-  _datagram_adapter.config_mut() = c_ad;
+  _datagram_adapter.set_config( c_ad );
 
   cerr << "DEBUG: Connecting to " << c_ad.destination.to_string() << "...\n";
 
@@ -274,9 +287,9 @@ void TCPMinnowSocket<AdaptT>::listen_and_accept( const TCPConfig& c_tcp, const F
     throw runtime_error( "listen_and_accept() with TCPConnection already initialized" );
   }
 
-  _initialize_TCP( c_tcp );
+  _initialize_TCP( fit_to_mtu( c_tcp, c_ad ) );
 
-  _datagram_adapter.config_mut() = c_ad;
+  _datagram_adapter.set_config( c_ad );
   _datagram_adapter.set_listening( true );
 
   cerr << "DEBUG: Listening for incoming connection...\n";
@@ -299,13 +312,40 @@ void TCPMinnowSocket<AdaptT>::_tcp_main()
       cerr << "DEBUG: TCP connection finished "
            << ( _tcp->inbound_reader().has_error() ? "uncleanly.\n" : "cleanly.\n" );
     }
+    if ( _tcp->inbound_reader().has_error() or _dump_trace ) {
+      save_trace();
+    }
     _tcp.reset();
   } catch ( const exception& e ) {
     cerr << "Exception in TCPConnection runner thread: " << e.what() << "\n";
+    save_trace();
     throw e;
   }
 }
 
+template<typename AdaptT>
+void TCPMinnowSocket<AdaptT>::dump_trace()
+{
+  if ( _trace_path.empty() ) {
+    throw runtime_error( "dump_trace() without a TCPConfig::trace_path" );
+  }
+  _dump_trace = true;
+}
+
+template<typename AdaptT>
+void TCPMinnowSocket<AdaptT>::save_trace()
+{
+  if ( not _tcp.has_value() or not _tcp->trace().enabled() or _trace_path.empty() ) {
+    return;
+  }
+  try {
+    _tcp->trace().dump( _trace_path );
+    cerr << "DEBUG: Dumped event trace to " << _trace_path << ".\n";
+  } catch ( const exception& e ) {
+    cerr << "DEBUG: " << e.what() << "\n";
+  }
+}
+
 template<typename AdaptT>
 void TCPMinnowSocket<AdaptT>::collect_segments()
 {
@@ -313,9 +353,8 @@ void TCPMinnowSocket<AdaptT>::collect_segments()
     return;
   }
 
-  while ( auto seg = _tcp->maybe_send() ) {
-    outgoing_segments_.push( move( seg.value() ) );
-  }
+  while ( _tcp->maybe_send( outgoing_segments_, TCP_SEND_BATCH ) == TCP_SEND_BATCH ) {}
+  _stats.store( _tcp->stats() );
 }
 
 //! Specialization of TCPMinnowSocket for TCPOverIPv4OverTunFdAdapter
@@ -327,6 +366,9 @@ template class TCPMinnowSocket<TCPOverIPv4OverEthernetAdapter>;
 //! Specialization of TCPMinnowSocket for LossyTCPOverIPv4OverTunFdAdapter
 template class TCPMinnowSocket<LossyTCPOverIPv4OverTunFdAdapter>;
 
+//! Specialization of TCPMinnowSocket for LossyPcapTCPOverIPv4OverTunFdAdapter
+template class TCPMinnowSocket<LossyPcapTCPOverIPv4OverTunFdAdapter>;
+
 CS144TCPSocket::CS144TCPSocket() : TCPOverIPv4MinnowSocket( TCPOverIPv4OverTunFdAdapter( TunFD( "tun144" ) ) ) {}
 
 void CS144TCPSocket::connect( const Address& address )
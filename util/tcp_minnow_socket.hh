@@ -4,6 +4,7 @@
 #include "eventloop.hh"
 #include "file_descriptor.hh"
 #include "network_interface.hh"
+#include "seqlock.hh"
 #include "socket.hh"
 #include "tcp_config.hh"
 #include "tcp_peer.hh"
@@ -12,9 +13,13 @@
 #include <atomic>
 #include <cstdint>
 #include <optional>
+#include <string>
 #include <thread>
 #include <vector>
 
+//! `c_tcp` with its MSS lowered, if need be, so that a full segment fits a datagram of `c_ad.mtu` bytes
+TCPConfig fit_to_mtu( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad );
+
 //! Multithreaded wrapper around TCPPeer that approximates the Unix sockets API
 template<typename AdaptT>
 class TCPMinnowSocket : public LocalStreamSocket
@@ -35,7 +40,7 @@ private:
   std::optional<TCPPeer> _tcp {};
 
   //! Segments queued to be sent on the network
-  std::queue<TCPSegment> outgoing_segments_ {};
+  std::vector<TCPSegment> outgoing_segments_ {};
 
   //! eventloop that handles all the events (new inbound datagram, new outbound bytes, new inbound bytes)
   EventLoop _eventloop {};
@@ -60,7 +65,15 @@ private:
 
   bool _fully_acked { false }; //!< Has the outbound data been fully acknowledged by the peer?
 
-  void collect_segments(); //!< Drain segments from the TCPPeer
+  void collect_segments(); //!< Drain segments from the TCPPeer (and publish its stats)
+
+  //! Latest TCPPeer::stats(), published by the TCPPeer thread for the owner to read
+  SeqLock<TCPStats> _stats {};
+
+  std::string _trace_path {};              //!< Where the TCPPeer's event trace is dumped (TCPConfig::trace_path)
+  std::atomic_bool _dump_trace { false }; //!< Flag used by the owner to have the TCPPeer thread dump the trace
+
+  void save_trace(); //!< Dump the TCPPeer's event trace, if it keeps one, to _trace_path
 
 public:
   //! Construct from the interface that the TCPPeer thread will use to read and write datagrams
@@ -77,6 +90,13 @@ public:
   //! Listen and accept using the specified configurations; blocks until accept succeeds or fails
   void listen_and_accept( const TCPConfig& c_tcp, const FdAdapterConfig& c_ad );
 
+  //! Counters and state of the connection, as of the TCPPeer thread's latest event; never blocks
+  TCPStats stats() const { return _stats.load(); }
+
+  //! Have the TCPPeer thread dump the connection's event trace to TCPConfig::trace_path (which it also does
+  //! when the connection fails)
+  void dump_trace();
+
   //! When a connected socket is destructed, it will send a RST
   ~TCPMinnowSocket();
 
@@ -105,6 +125,7 @@ using TCPOverIPv4MinnowSocket = TCPMinnowSocket<TCPOverIPv4OverTunFdAdapter>;
 using TCPOverIPv4OverEthernetMinnowSocket = TCPMinnowSocket<TCPOverIPv4OverEthernetAdapter>;
 
 using LossyTCPOverIPv4MinnowSocket = TCPMinnowSocket<LossyTCPOverIPv4OverTunFdAdapter>;
+using LossyPcapTCPOverIPv4MinnowSocket = TCPMinnowSocket<LossyPcapTCPOverIPv4OverTunFdAdapter>;
 
 //! \class TCPMinnowSocket
 //! This class involves the simultaneous operation of two threads.
@@ -11,6 +11,45 @@
 
 using namespace std;
 
+optional<TCPSegment> parse_tcp_in_ip( const InternetDatagram& ip_dgram )
+{
+  // does the IPv4 datagram claim that its payload is a TCP segment?
+  if ( ip_dgram.header.proto != IPv4Header::PROTO_TCP ) {
+    return {};
+  }
+
+  // is the payload a valid TCP segment?
+  TCPSegment tcp_seg;
+  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
+    return {};
+  }
+  tcp_seg.ecn = ip_dgram.header.tos & IPv4Header::ECN_MASK;
+  return tcp_seg;
+}
+
+//! \param[in] seg is the TCP segment to convert
+//! \param[in] tuple is the connection it belongs to, as seen from the sending end
+InternetDatagram wrap_tcp_in_ip( TCPSegment& seg, const FourTuple& tuple )
+{
+  // set the port numbers in the TCP segment
+  seg.udinfo.src_port = tuple.local_port;
+  seg.udinfo.dst_port = tuple.remote_port;
+
+  // create an Internet Datagram and set its addresses and length
+  InternetDatagram ip_dgram;
+  ip_dgram.header.src = tuple.local_ip;
+  ip_dgram.header.dst = tuple.remote_ip;
+  ip_dgram.header.tos = seg.ecn & IPv4Header::ECN_MASK;
+  ip_dgram.header.len = ip_dgram.header.hlen * 4 + seg.header_length() + seg.sender_message.payload.size();
+
+  // set payload, calculating TCP checksum using information from IP header
+  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
+  ip_dgram.header.compute_checksum();
+  ip_dgram.payload = serialize( seg );
+
+  return ip_dgram;
+}
+
 //! \details This function attempts to parse a TCP segment from
 //! the IP datagram's payload.
 //!
@@ -36,16 +75,11 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     return {};
   }
 
-  // does the IPv4 datagram claim that its payload is a TCP segment?
-  if ( ip_dgram.header.proto != IPv4Header::PROTO_TCP ) {
-    return {};
-  }
-
-  // is the payload a valid TCP segment?
-  TCPSegment tcp_seg;
-  if ( not parse( tcp_seg, ip_dgram.payload, ip_dgram.header.pseudo_checksum() ) ) {
+  auto parsed = parse_tcp_in_ip( ip_dgram );
+  if ( not parsed.has_value() ) {
     return {};
   }
+  TCPSegment& tcp_seg = parsed.value();
 
   // is the TCP segment for us?
   if ( tcp_seg.udinfo.dst_port != config().source.port() ) {
@@ -69,27 +103,16 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip( const InternetDatagra
     return {};
   }
 
-  return tcp_seg;
+  return parsed;
 }
 
 //! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
 //! \param[in] seg is the TCP segment to convert
 InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip( TCPSegment& seg )
 {
-  // set the port numbers in the TCP segment
-  seg.udinfo.src_port = config().source.port();
-  seg.udinfo.dst_port = config().destination.port();
-
-  // create an Internet Datagram and set its addresses and length
-  InternetDatagram ip_dgram;
-  ip_dgram.header.src = config().source.ipv4_numeric();
-  ip_dgram.header.dst = config().destination.ipv4_numeric();
-  ip_dgram.header.len = ip_dgram.header.hlen * 4 + 20 /* tcp header len */ + seg.sender_message.payload.size();
-
-  // set payload, calculating TCP checksum using information from IP header
-  seg.compute_checksum( ip_dgram.header.pseudo_checksum() );
-  ip_dgram.header.compute_checksum();
-  ip_dgram.payload = serialize( seg );
-
-  return ip_dgram;
+  return ::wrap_tcp_in_ip( seg,
+                           { config().source.ipv4_numeric(),
+                             config().destination.ipv4_numeric(),
+                             config().source.port(),
+                             config().destination.port() } );
 }
@@ -3,10 +3,23 @@
 #include "buffer.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "tcp_connection_table.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
 
+//! Parse the TCP segment an IPv4 datagram carries; empty if it carries none, or an invalid one
+std::optional<TCPSegment> parse_tcp_in_ip( const InternetDatagram& ip_dgram );
+
+//! Set the ports of a TCP segment from `tuple` and wrap it in an IPv4 datagram from tuple.local to tuple.remote
+InternetDatagram wrap_tcp_in_ip( TCPSegment& seg, const FourTuple& tuple );
+
+//! The 4-tuple of the connection an arriving segment belongs to, as seen from the receiving end
+inline FourTuple arriving_four_tuple( const InternetDatagram& ip_dgram, const TCPSegment& seg )
+{
+  return { ip_dgram.header.dst, ip_dgram.header.src, seg.udinfo.dst_port, seg.udinfo.src_port };
+}
+
 //! \brief A converter from TCP segments to serialized IPv4 datagrams
 class TCPOverIPv4Adapter : public FdAdapterBase
 {
@@ -1,13 +1,39 @@
 #pragma once
 
+#include "ipv4_header.hh"
 #include "tcp_config.hh"
 #include "tcp_receiver.hh"
 #include "tcp_receiver_message.hh"
 #include "tcp_segment.hh"
 #include "tcp_sender.hh"
 #include "tcp_sender_message.hh"
+#include "tcp_trace.hh"
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <optional>
+#include <utility>
+#include <vector>
+
+// A snapshot of a connection's counters and state, in the manner of Linux's struct tcp_info. Byte counts
+// are of payload; what was sent includes retransmissions.
+struct TCPStats
+{
+  uint64_t segments_sent {}, bytes_sent {};
+  uint64_t segments_received {}, bytes_received {};
+  uint64_t segments_retransmitted {}, bytes_retransmitted {};
+  uint64_t dup_acks {};              // pure ACKs that acknowledged nothing new while data was in flight
+  uint64_t out_of_order_bytes {};    // payload that arrived ahead of the next byte expected
+  uint64_t zero_windows_received {}; // times the peer closed its window
+  uint64_t zero_windows_sent {};     // times we closed ours
+  uint64_t rto_ms {};
+  uint64_t srtt_ms {};           // 0 until the first RTT sample
+  uint64_t cwnd {};              // 0 without congestion control
+  uint64_t window_advertised {}; // latest window we advertised, in bytes
+  uint64_t peer_window {};       // latest window the peer advertised, in bytes
+  uint64_t sequence_numbers_in_flight {};
+};
 
 // Consists sender, receiver, reassembler, io stream
 class TCPPeer
@@ -21,14 +47,405 @@ class TCPPeer
 
   bool need_send_ {};
 
+  // Counters for stats(); the rest of the snapshot is read off the sender and receiver when asked for
+  TCPStats stats_ {};
+
+  void count_sent( const TCPSegment& seg, bool retransmitted )
+  {
+    stats_.segments_sent++;
+    stats_.bytes_sent += seg.sender_message.payload.size();
+    const uint32_t seqno = raw( seg.sender_message.seqno );
+    const auto length = static_cast<uint32_t>( seg.sender_message.sequence_length() );
+    if ( length > 0 and not retransmitted ) {
+      snd_max_ = seqno + length;
+    }
+    if ( trace_.enabled() ) {
+      trace_.record(
+        retransmitted ? TCPTrace::Kind::Retransmitted : TCPTrace::Kind::Sent, seqno, length, last_window_sent_ );
+    }
+  }
+
+  // A segment from the sender that starts below the highest seqno sent so far (snd_max_, raw) is a
+  // retransmission: TCPSender resends only what it has already sent, and sends new data in order.
+  std::optional<uint32_t> snd_max_ {};
+
+  static uint32_t raw( Wrap32 seqno ) { return static_cast<uint32_t>( seqno.unwrap( Wrap32 { 0 }, 0 ) ); }
+
+  bool retransmission( const TCPSenderMessage& msg ) const
+  {
+    return msg.sequence_length() > 0 and snd_max_.has_value()
+           and static_cast<int32_t>( raw( msg.seqno ) - snd_max_.value() ) < 0;
+  }
+
+  // Event trace, if cfg_.trace_events asks for one
+  TCPTrace trace_ { cfg_.trace_events };
+
+  // Milliseconds since construction (plus one, so that a TSval is never zero); drives TSval
+  uint64_t now_ms_ { 1 };
+
+  // RFC 7323 timestamps are in use once both SYNs have carried the option
+  bool timestamps_ok_ {};
+
+  // RFC 7323 window scaling: the shift we offer (enough to advertise all of recv_capacity), and the
+  // shifts in effect once both SYNs have carried the option
+  uint8_t offered_window_shift_ { window_shift_for(
+    cfg_.recv_autotune ? std::max( cfg_.recv_capacity, cfg_.recv_capacity_max ) : cfg_.recv_capacity ) };
+  uint8_t snd_window_shift_ {};
+  bool window_scale_ok_ {};
+
+  // ECN (RFC 3168), once the SYN exchange has negotiated it. As receiver, we echo CE marks with ECE until
+  // the sender answers with CWR (with DCTCP: ECE mirrors the CE mark of the latest data, changes ACKed at
+  // once); as sender, our next new data carries CWR after each reduction of the congestion window.
+  bool ecn_ok_ {};
+  bool ece_pending_ {};
+  bool ce_state_ {};
+  bool cwr_pending_ {};
+
+  // Smaller of our MSS and the peer's; a segment's payload and options together stay within it
+  size_t negotiated_mss_ { TCPConfig::DEFAULT_PEER_MSS };
+  size_t peer_mss_ { TCPConfig::DEFAULT_PEER_MSS };
+
+  // TCP Fast Open (RFC 7413). A client's SYN presents the cookie it holds for the server (and then carries
+  // data), or else asks for one; a server's SYN-ACK carries the cookie it grants. The cookie a client is
+  // granted waits here until taken for the cache.
+  std::optional<TCPOptions::FastOpenCookie> fast_open_cookie_ {};
+  bool fast_open_request_ {};
+  std::optional<TCPOptions::FastOpenCookie> granted_cookie_ {};
+
+  // RFC 2018 SACK, once both SYNs have carried SACK-permitted. We report the out-of-order ranges we
+  // hold as stream indices [left, right), the one holding the most recent arrival first.
+  bool sack_ok_ {};
+  struct SackRange
+  {
+    uint64_t left, right;
+  };
+  std::array<SackRange, TCPOptions::MAX_SACK_BLOCKS> sack_ranges_ {};
+  size_t sack_range_count_ {};
+
+  void record_sack( SackRange range )
+  {
+    // Merge with any range it overlaps or touches, then put it first
+    std::array<SackRange, TCPOptions::MAX_SACK_BLOCKS> kept {};
+    size_t kept_count = 0;
+    for ( size_t i = 0; i < sack_range_count_; i++ ) {
+      const auto& r = sack_ranges_[i];
+      if ( r.right < range.left or range.right < r.left ) {
+        kept[kept_count++] = r;
+      } else {
+        range = { std::min( r.left, range.left ), std::max( r.right, range.right ) };
+      }
+    }
+    sack_ranges_[0] = range;
+    sack_range_count_ = std::min( kept_count + 1, sack_ranges_.size() );
+    std::copy( kept.begin(), kept.begin() + ( sack_range_count_ - 1 ), sack_ranges_.begin() + 1 );
+  }
+
+  // Forget ranges the ackno has caught up with
+  void prune_sack()
+  {
+    const uint64_t acked = inbound_stream_.writer().bytes_pushed();
+    size_t kept_count = 0;
+    for ( size_t i = 0; i < sack_range_count_; i++ ) {
+      if ( sack_ranges_[i].right > acked ) {
+        sack_ranges_[kept_count++] = { std::max( sack_ranges_[i].left, acked ), sack_ranges_[i].right };
+      }
+    }
+    sack_range_count_ = kept_count;
+  }
+
+  static uint8_t window_shift_for( uint64_t capacity )
+  {
+    uint8_t shift = 0;
+    while ( shift < TCPOptions::MAX_WINDOW_SCALE and ( uint64_t { UINT16_MAX } << shift ) < capacity ) {
+      shift++;
+    }
+    return shift;
+  }
+
+  // Set when the peer's FIN arrives before our outbound stream has ended: the peer closed first, so it is
+  // the one to wait in TIME_WAIT
+  bool passive_close_ {};
+
+  // Delayed ACKs (RFC 1122): in-order data is acknowledged on every second full-sized segment, or
+  // once the ACK has been held back for cfg_.delayed_ack_ms
+  std::optional<uint64_t> ack_deadline_ms_ {};
+  unsigned full_segments_unacked_ {};
+  uint32_t last_window_sent_ {};
+  std::optional<Wrap32> last_ack_sent_ {}; // Last.ACK.sent (RFC 7323), which gates updates to TS.Recent
+
+  // Decide whether an arriving segment that needs acknowledgment is ACKed now or later
+  void schedule_ack( bool syn_or_fin, size_t payload_size, bool in_order, bool filled_hole )
+  {
+    const uint64_t delay = std::min( cfg_.delayed_ack_ms, TCPConfig::MAX_DELAYED_ACK_MS );
+    if ( delay == 0 or syn_or_fin or not in_order or filled_hole or reassembler_.bytes_pending() > 0 ) {
+      need_send_ = true;
+      return;
+    }
+
+    if ( payload_size >= sender_.max_payload_size() and ++full_segments_unacked_ >= 2 ) {
+      need_send_ = true;
+      return;
+    }
+
+    if ( not ack_deadline_ms_.has_value() ) {
+      ack_deadline_ms_ = now_ms_ + delay;
+    }
+  }
+
+  // Any segment carrying our ackno satisfies a pending delayed ACK
+  void ack_sent( const TCPReceiverMessage& receiver_msg )
+  {
+    if ( receiver_msg.ackno.has_value() ) {
+      ack_deadline_ms_.reset();
+      full_segments_unacked_ = 0;
+      last_ack_sent_ = receiver_msg.ackno;
+      if ( receiver_msg.window_size == 0 and last_window_sent_ != 0 ) {
+        stats_.zero_windows_sent++;
+      }
+      if ( trace_.enabled() and receiver_msg.window_size != last_window_sent_ ) {
+        trace_.record( TCPTrace::Kind::OurWindow, 0, 0, receiver_msg.window_size );
+      }
+      last_window_sent_ = receiver_msg.window_size;
+      advertised_right_edge_
+        = std::max( advertised_right_edge_, inbound_stream_.writer().bytes_pushed() + receiver_msg.window_size );
+    }
+  }
+
+  // Receiver silly window syndrome avoidance (RFC 1122 4.2.3.3): the right edge of the window only moves
+  // on in steps of at least min(MSS, half the buffer), and in whole segments when it can, so the peer is
+  // never invited to send a runt; until then keep offering what is left of the old window.
+  // (The peer's segments carry the same option bytes as ours, so our effective MSS is theirs.)
+  uint64_t sws_threshold() const
+  {
+    return std::min<uint64_t>( sender_.max_payload_size(), inbound_stream_.capacity() / 2 );
+  }
+
+  TCPReceiverMessage receiver_message() const
+  {
+    auto msg = receiver_.send( inbound_stream_.writer() );
+    const uint64_t pushed = inbound_stream_.writer().bytes_pushed();
+    const uint64_t edge = pushed + msg.window_size;
+    if ( not msg.ackno.has_value() or edge <= advertised_right_edge_ ) {
+      return msg;
+    }
+
+    const uint64_t mss = sender_.max_payload_size();
+    uint64_t growth = edge - advertised_right_edge_;
+    if ( growth < sws_threshold() ) {
+      growth = 0;
+    } else if ( growth >= mss ) {
+      growth = growth / mss * mss;
+    }
+
+    // Round up to what the scaled window field can express; that still fits the buffer
+    const uint64_t unit = uint64_t { 1 } << receiver_.window_scale();
+    const uint64_t held = advertised_right_edge_ > pushed ? advertised_right_edge_ - pushed : 0;
+    msg.window_size
+      = static_cast<uint32_t>( std::min<uint64_t>( ( held + growth + unit - 1 ) / unit * unit, msg.window_size ) );
+    return msg;
+  }
+
+  // Send a window update once the application has reopened the window: a held-back ACK goes out on any
+  // growth, and otherwise a pure ACK when the window the peer sees is small next to what it could be
+  void check_window_update( const TCPReceiverMessage& receiver_msg )
+  {
+    if ( not receiver_msg.ackno.has_value() ) {
+      return;
+    }
+    if ( ack_deadline_ms_.has_value() and receiver_msg.window_size > last_window_sent_ ) {
+      need_send_ = true;
+    }
+
+    const uint64_t pushed = inbound_stream_.writer().bytes_pushed();
+    const uint64_t remaining = advertised_right_edge_ > pushed ? advertised_right_edge_ - pushed : 0;
+    if ( receiver_msg.window_size >= remaining + sws_threshold() and receiver_msg.window_size >= 2 * remaining ) {
+      need_send_ = true;
+    }
+  }
+
+  // Receive-buffer autotuning (after Linux's tcp_rcv_space_adjust): once per RTT, size the inbound
+  // stream to twice what the application drained over that RTT, within the configured bounds.
+  std::optional<uint64_t> rcv_rtt_ms_ {}; // RTT measured by the receiving side, from echoed TSvals
+  uint64_t space_start_ms_ {};
+  uint64_t space_popped_ {};
+  uint64_t advertised_right_edge_ {}; // stream index just past the highest window edge we have advertised
+
+  void rcv_rtt_sample( uint64_t rtt_ms )
+  {
+    rcv_rtt_ms_ = rcv_rtt_ms_.has_value() ? ( 7 * rcv_rtt_ms_.value() + rtt_ms ) / 8 : rtt_ms;
+  }
+
+  void adjust_receive_space()
+  {
+    const auto rtt = rcv_rtt_ms_.has_value() ? rcv_rtt_ms_ : sender_.srtt_ms();
+    if ( not cfg_.recv_autotune or not rtt.has_value()
+         or now_ms_ - space_start_ms_ < std::max<uint64_t>( *rtt, 1 ) ) {
+      return;
+    }
+
+    const uint64_t popped = inbound_stream_.reader().bytes_popped();
+    const uint64_t drained = popped - space_popped_;
+    space_start_ms_ = now_ms_;
+    space_popped_ = popped;
+
+    // Without window scaling, anything beyond what the window field can advertise is wasted
+    const uint64_t ceiling
+      = window_scale_ok_ ? cfg_.recv_capacity_max : std::min<uint64_t>( cfg_.recv_capacity_max, UINT16_MAX );
+    const uint64_t lowest = std::min<uint64_t>( cfg_.recv_capacity_min, ceiling );
+    const uint64_t target = std::clamp<uint64_t>( 2 * drained, lowest, ceiling );
+    const uint64_t capacity = inbound_stream_.capacity();
+
+    if ( target > capacity ) {
+      inbound_stream_.set_capacity( target );
+    } else if ( target < capacity / 2 ) {
+      // Shrink at most by half per RTT, and never pull back the window edge already advertised. Even
+      // when that edge pins the capacity (an idle connection), this frees the memory of popped bytes.
+      const uint64_t floor = advertised_right_edge_ > popped ? advertised_right_edge_ - popped : 0;
+      inbound_stream_.set_capacity( std::max( { target, capacity / 2, floor } ) );
+    }
+  }
+
+  // The first new data segment after a congestion window reduction tells the receiver to stop sending ECE
+  void mark_cwr( TCPSegment& seg, bool retransmitted )
+  {
+    if ( cwr_pending_ and not retransmitted and not seg.sender_message.payload.empty() ) {
+      seg.cwr = true;
+      cwr_pending_ = false;
+    }
+  }
+
+  // Scratch space reused by the batched maybe_send()
+  std::vector<TCPSenderMessage> sender_batch_ {};
+
+  // Build an outgoing segment, attaching the header options in effect for this connection
+  TCPSegment make_segment( TCPSenderMessage sender_msg,
+                           const TCPReceiverMessage& receiver_msg,
+                           bool reset,
+                           bool retransmitted ) const
+  {
+    TCPSegment seg { std::move( sender_msg ), receiver_msg, reset };
+
+    // The window field of a SYN is never scaled; otherwise put the scaled value on the wire
+    if ( seg.sender_message.SYN ) {
+      seg.receiver_message.window_size = std::min<uint32_t>( receiver_msg.window_size, UINT16_MAX );
+    } else {
+      seg.receiver_message.window_size = receiver_msg.window_size >> receiver_.window_scale();
+    }
+
+    // Offer timestamps on our SYN until we know whether the peer's SYN carried them
+    const bool offer_timestamps = cfg_.timestamps and seg.sender_message.SYN and not receiver_msg.ackno.has_value();
+    if ( timestamps_ok_ or offer_timestamps ) {
+      seg.options.timestamps
+        = TCPOptions::Timestamps { static_cast<uint32_t>( now_ms_ ), receiver_.ts_recent().value_or( 0 ) };
+    }
+    if ( seg.sender_message.SYN ) {
+      seg.options.mss = cfg_.mss;
+    }
+    if ( seg.sender_message.SYN and ( window_scale_ok_ or ( cfg_.window_scaling and not receiver_msg.ackno ) ) ) {
+      seg.options.window_scale = offered_window_shift_;
+    }
+    if ( seg.sender_message.SYN and ( sack_ok_ or ( cfg_.sack and not receiver_msg.ackno ) ) ) {
+      seg.options.sack_permitted = true;
+    }
+    if ( seg.sender_message.SYN and fast_open_cookie_.has_value() ) {
+      seg.options.fast_open = fast_open_cookie_;
+    } else if ( seg.sender_message.SYN and fast_open_request_ and not receiver_msg.ackno ) {
+      seg.options.fast_open = TCPOptions::FastOpenCookie {};
+    }
+
+    // An ECN-setup SYN carries ECE and CWR; the SYN-ACK that accepts it carries ECE alone
+    if ( seg.sender_message.SYN ) {
+      seg.ece = receiver_msg.ackno.has_value() ? ecn_ok_ : cfg_.ecn;
+      seg.cwr = cfg_.ecn and not receiver_msg.ackno.has_value();
+    } else if ( ecn_ok_ ) {
+      seg.ece = cfg_.dctcp ? ce_state_ : ece_pending_;
+      // Pure ACKs stay Not-ECT, and so do retransmissions (RFC 3168 6.1.5)
+      if ( not seg.sender_message.payload.empty() and not retransmitted ) {
+        seg.ecn = IPv4Header::ECN_ECT0;
+      }
+    }
+
+    // SACK blocks, as many as fit beside the payload within the negotiated MSS
+    if ( sack_ok_ and receiver_msg.ackno.has_value() and sack_range_count_ > 0 ) {
+      const uint64_t acked = inbound_stream_.writer().bytes_pushed();
+      for ( size_t i = 0; i < sack_range_count_; i++ ) {
+        const auto& r = sack_ranges_[i];
+        seg.options.sack_blocks[i] = { *receiver_msg.ackno + static_cast<uint32_t>( r.left - acked ),
+                                       *receiver_msg.ackno + static_cast<uint32_t>( r.right - acked ) };
+      }
+      seg.options.sack_block_count = sack_range_count_;
+      while ( seg.options.sack_block_count > 0
+              and seg.sender_message.payload.size() + seg.options.serialized_length() > negotiated_mss_ ) {
+        seg.options.sack_block_count--;
+      }
+    }
+    return seg;
+  }
+
 public:
-  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) {}
+  explicit TCPPeer( const TCPConfig& cfg ) : cfg_( cfg ) { sender_.set_rack_tlp( cfg_.rack_tlp ); }
+
+  // Client: connect with TCP Fast Open. With a cookie from an earlier connection to the server (whose MSS
+  // was `peer_mss`), the SYN presents it and carries what is already in the outbound stream; without one,
+  // the SYN asks for a cookie. Either way, a cookie the SYN-ACK grants can then be taken. Call before the
+  // first push().
+  void fast_open( const std::optional<TCPOptions::FastOpenCookie>& cookie, size_t peer_mss )
+  {
+    fast_open_request_ = true;
+    fast_open_cookie_ = cookie;
+    if ( cookie.has_value() ) {
+      // leave room for every option the SYN may carry
+      const size_t mss = std::max<size_t>( std::min<size_t>( cfg_.mss, peer_mss ), TCPOptions::MAX_LENGTH );
+      sender_.set_syn_payload_limit( mss - TCPOptions::MAX_LENGTH );
+    }
+  }
+
+  // Server: grant a Fast Open cookie in our SYN-ACK. Call before the first maybe_send().
+  void grant_fast_open_cookie( const TCPOptions::FastOpenCookie& cookie ) { fast_open_cookie_ = cookie; }
+
+  // Client: the cookie the server granted us, if any (once), with the server's MSS
+  std::optional<TCPOptions::FastOpenCookie> take_fast_open_cookie() { return std::exchange( granted_cookie_, {} ); }
+  size_t peer_mss() const { return peer_mss_; }
 
   Writer& outbound_writer() { return outbound_stream_.writer(); }
   Reader& inbound_reader() { return inbound_stream_.reader(); }
 
   void push() { sender_.push( outbound_stream_.reader() ); };
-  void tick( uint64_t ms_since_last_tick ) { sender_.tick( ms_since_last_tick ); }
+  void tick( uint64_t ms_since_last_tick )
+  {
+    now_ms_ += ms_since_last_tick;
+    const auto retransmissions = sender_.consecutive_retransmissions();
+    sender_.tick( ms_since_last_tick );
+    if ( trace_.enabled() and sender_.consecutive_retransmissions() > retransmissions ) {
+      trace_.record( TCPTrace::Kind::RtoFired,
+                     0,
+                     static_cast<uint32_t>( sender_.consecutive_retransmissions() ),
+                     static_cast<uint32_t>( sender_.current_RTO_ms() ) );
+    }
+
+    if ( ack_deadline_ms_.has_value() and now_ms_ >= ack_deadline_ms_.value() ) {
+      need_send_ = true;
+    }
+
+    if ( has_ackno() ) {
+      adjust_receive_space();
+    }
+  }
+
+  // Milliseconds until each of the connection's timers needs a tick() to fire (empty while it is not
+  // running), so that an owner of many connections can keep them on a TimerWheel and tick only those due
+  std::optional<uint64_t> retransmission_timer_ms() const { return sender_.retransmission_timer_ms(); }
+  std::optional<uint64_t> loss_detection_timer_ms() const { return sender_.loss_detection_timer_ms(); }
+  std::optional<uint64_t> delayed_ack_timer_ms() const
+  {
+    if ( not ack_deadline_ms_.has_value() ) {
+      return {};
+    }
+    return ack_deadline_ms_.value() > now_ms_ ? ack_deadline_ms_.value() - now_ms_ : 0;
+  }
+
+  // Whether this side closed first (and was not reset), so should linger in TIME_WAIT once inactive
+  bool lingers() const { return not passive_close_ and not inbound_stream_.reader().has_error(); }
 
   bool has_ackno() const { return receiver_.send( inbound_stream_.writer() ).ackno.has_value(); }
 
@@ -43,33 +460,175 @@ public:
 
   void receive( TCPSegment seg )
   {
+    stats_.segments_received++;
+    stats_.bytes_received += seg.sender_message.payload.size();
+
     if ( seg.reset or inbound_reader().has_error() ) {
       inbound_stream_.writer().set_error();
       return;
     }
 
-    // Give incoming TCPReceiverMessage to sender.
+    if ( seg.sender_message.SYN ) {
+      timestamps_ok_ = cfg_.timestamps and seg.options.timestamps.has_value();
+
+      window_scale_ok_ = cfg_.window_scaling and seg.options.window_scale.has_value();
+      // Shifts beyond 14 are treated as 14 (RFC 7323 2.3), so a scaled window always fits 32 bits
+      snd_window_shift_
+        = window_scale_ok_ ? std::min( seg.options.window_scale.value(), TCPOptions::MAX_WINDOW_SCALE ) : 0;
+      receiver_.set_window_scale( window_scale_ok_ ? offered_window_shift_ : 0 );
+
+      sack_ok_ = cfg_.sack and seg.options.sack_permitted;
+
+      const bool syn_ack = seg.receiver_message.ackno.has_value();
+      ecn_ok_ = cfg_.ecn and seg.ece and ( syn_ack ? not seg.cwr : seg.cwr );
+
+      if ( syn_ack and fast_open_request_ and seg.options.fast_open.has_value()
+           and seg.options.fast_open->length > 0 ) {
+        granted_cookie_ = seg.options.fast_open;
+      }
+
+      // Effective MSS: what both ends accept, less the option bytes every segment will carry. The peer's MSS
+      // comes off the wire, so a tiny one is raised to MIN_PEER_MSS rather than left to starve the payload.
+      peer_mss_ = std::max( seg.options.mss.value_or( TCPConfig::DEFAULT_PEER_MSS ), TCPConfig::MIN_PEER_MSS );
+      const size_t option_bytes = timestamps_ok_ ? TCPOptions::TIMESTAMPS_LENGTH : 0;
+      negotiated_mss_ = std::min<size_t>( cfg_.mss, peer_mss_ );
+      sender_.set_max_payload_size( negotiated_mss_ > option_bytes ? negotiated_mss_ - option_bytes : 1 );
+      if ( cfg_.congestion_control and not sender_.cwnd().has_value() ) {
+        sender_.enable_congestion_control( cfg_.dctcp );
+      }
+    }
+
+    // The window field of a SYN is never scaled
+    if ( not seg.sender_message.SYN ) {
+      seg.receiver_message.window_size <<= snd_window_shift_;
+    }
+
+    // PAWS: drop old duplicates, but acknowledge them so the peer resynchronizes.
+    const auto& timestamps = seg.options.timestamps;
+    if ( timestamps_ok_ and timestamps.has_value()
+         and not receiver_.check_timestamp( seg.sender_message, timestamps->tsval, last_ack_sent_ ) ) {
+      need_send_ = true;
+      return;
+    }
+
+    // Give incoming SACK blocks and TCPReceiverMessage to sender.
+    if ( sack_ok_ ) {
+      for ( size_t i = 0; i < seg.options.sack_block_count; i++ ) {
+        sender_.receive_sack( seg.options.sack_blocks[i].left, seg.options.sack_blocks[i].right );
+      }
+    }
+    const auto in_flight = sender_.sequence_numbers_in_flight();
+    const bool maybe_dup_ack = seg.receiver_message.ackno.has_value() and seg.sender_message.sequence_length() == 0
+                               and in_flight > 0 and seg.receiver_message.window_size == sender_.window();
+    if ( seg.receiver_message.window_size == 0 and sender_.window() != 0 ) {
+      stats_.zero_windows_received++;
+    }
+    if ( trace_.enabled() and seg.receiver_message.window_size != sender_.window() ) {
+      trace_.record( TCPTrace::Kind::PeerWindow, 0, 0, seg.receiver_message.window_size );
+    }
     sender_.receive( seg.receiver_message );
+    if ( maybe_dup_ack and sender_.sequence_numbers_in_flight() == in_flight ) {
+      stats_.dup_acks++;
+    }
+    if ( trace_.enabled() and seg.receiver_message.ackno.has_value() ) {
+      trace_.record( TCPTrace::Kind::AckReceived,
+                     raw( seg.receiver_message.ackno.value() ),
+                     static_cast<uint32_t>( in_flight - sender_.sequence_numbers_in_flight() ),
+                     seg.receiver_message.window_size );
+    }
+
+    // ECN: the peer's echo of CE marks may shrink our congestion window
+    if ( ecn_ok_ and not seg.sender_message.SYN
+         and sender_.ecn_echo( seg.ece, in_flight - sender_.sequence_numbers_in_flight() ) ) {
+      cwr_pending_ = true;
+    }
+
+    // ...and CE marks on what it sent must be echoed back
+    if ( ecn_ok_ and not seg.sender_message.SYN ) {
+      const bool ce = seg.ecn == IPv4Header::ECN_CE;
+      if ( seg.cwr ) {
+        ece_pending_ = false;
+      }
+      ece_pending_ |= ce;
+      if ( cfg_.dctcp and seg.sender_message.sequence_length() > 0 and ce != ce_state_ ) {
+        ce_state_ = ce;
+        need_send_ = true;
+      }
+    }
+
+    // An ACK of new data echoing one of our TSvals yields an RTT sample, retransmission or not.
+    if ( timestamps_ok_ and timestamps.has_value() and timestamps->tsecr != 0
+         and sender_.sequence_numbers_in_flight() < in_flight ) {
+      sender_.rtt_sample( static_cast<uint32_t>( now_ms_ ) - timestamps->tsecr );
+    }
+
+    // Data echoing one of our TSvals also measures the RTT as the receiving side sees it
+    if ( timestamps_ok_ and timestamps.has_value() and timestamps->tsecr != 0
+         and not seg.sender_message.payload.empty() ) {
+      rcv_rtt_sample( static_cast<uint32_t>( now_ms_ ) - timestamps->tsecr );
+    }
 
     // Give incoming TCPSenderMessage to receiver.
-    // If SenderMessage is non-empty or a keep-alive, make sure to reply.
-    need_send_ |= ( seg.sender_message.sequence_length() > 0 );
+    // If SenderMessage is non-empty or a keep-alive, make sure to reply (a keep-alive at once).
     const auto our_ackno = receiver_.send( inbound_stream_.writer() ).ackno;
-    need_send_ |= ( our_ackno.has_value() and seg.sender_message.seqno + 1 == our_ackno.value() );
+    const bool keep_alive = our_ackno.has_value() and seg.sender_message.seqno + 1 == our_ackno.value();
+    need_send_ |= keep_alive;
 
+    const bool in_order
+      = seg.sender_message.SYN or ( our_ackno.has_value() and seg.sender_message.seqno == our_ackno.value() );
+    const bool filled_hole = reassembler_.bytes_pending() > 0;
+    const bool occupies_space = seg.sender_message.sequence_length() > 0;
+    const bool syn_or_fin = seg.sender_message.SYN or seg.sender_message.FIN;
+    const size_t payload_size = seg.sender_message.payload.size();
+
+    // Where the data starts relative to the next byte we expect (negative for old duplicates)
+    const auto offset
+      = our_ackno.has_value()
+          ? static_cast<int32_t>( static_cast<uint32_t>( seg.sender_message.seqno.unwrap( our_ackno.value(), 0 ) ) )
+          : 0;
+    if ( not in_order and payload_size > 0 and offset > 0 ) {
+      stats_.out_of_order_bytes += payload_size;
+      if ( trace_.enabled() ) {
+        trace_.record( TCPTrace::Kind::OutOfOrder,
+                       raw( seg.sender_message.seqno ),
+                       static_cast<uint32_t>( payload_size ),
+                       static_cast<uint32_t>( offset ) );
+      }
+    }
+
+    // Out-of-order data the reassembler will hold on to goes into our SACK blocks
+    if ( sack_ok_ and our_ackno.has_value() and not in_order and payload_size > 0 ) {
+      const uint64_t acked = inbound_stream_.writer().bytes_pushed();
+      const uint64_t window_end = acked + inbound_stream_.writer().available_capacity();
+      if ( offset > 0 and acked + offset < window_end ) {
+        record_sack( { acked + offset, std::min( acked + offset + payload_size, window_end ) } );
+      }
+    }
+
+    const bool was_closed = inbound_stream_.writer().is_closed();
     receiver_.receive( std::move( seg.sender_message ), reassembler_, inbound_stream_.writer() );
+    prune_sack();
+    if ( not was_closed and inbound_stream_.writer().is_closed() and not outbound_stream_.reader().is_finished() ) {
+      passive_close_ = true;
+    }
+
+    if ( occupies_space ) {
+      schedule_ack( syn_or_fin, payload_size, in_order, filled_hole );
+    }
   }
 
   std::optional<TCPSegment> maybe_send()
   {
     // Get outgoing TCPReceiverMessage from receiver.
-    auto receiver_msg = receiver_.send( inbound_stream_.writer() );
+    auto receiver_msg = receiver_message();
 
     // If connection is alive, push stream to TCPSender.
     if ( receiver_msg.ackno.has_value() ) {
       push();
     }
 
+    check_window_update( receiver_msg );
+
     // Get (possible) outgoing TCPSenderMessage, using empty message if we need to send something.
     auto sender_msg = sender_.maybe_send();
 
@@ -81,15 +640,79 @@ public:
 
     // Send the segment
     if ( sender_msg.has_value() ) {
-      return TCPSegment {
-        sender_msg.value(), receiver_msg, outbound_stream_.reader().has_error() or inbound_reader().has_error() };
+      ack_sent( receiver_msg );
+      const bool retransmitted = retransmission( sender_msg.value() );
+      auto seg = make_segment( sender_msg.value(),
+                               receiver_msg,
+                               outbound_stream_.reader().has_error() or inbound_reader().has_error(),
+                               retransmitted );
+      mark_cwr( seg, retransmitted );
+      count_sent( seg, retransmitted );
+      return seg;
     }
 
     return {};
   }
 
+  // Append up to `max_count` ready segments to `out`, sharing one receiver message; returns how many were added.
+  size_t maybe_send( std::vector<TCPSegment>& out, size_t max_count )
+  {
+    if ( max_count == 0 ) {
+      return 0;
+    }
+
+    // Get outgoing TCPReceiverMessage from receiver once for the whole batch.
+    const auto receiver_msg = receiver_message();
+
+    // If connection is alive, push stream to TCPSender.
+    if ( receiver_msg.ackno.has_value() ) {
+      push();
+    }
+
+    check_window_update( receiver_msg );
+
+    sender_batch_.clear();
+    sender_.maybe_send( sender_batch_, max_count );
+
+    if ( need_send_ and sender_batch_.empty() ) {
+      sender_batch_.push_back( sender_.send_empty_message() );
+    }
+
+    need_send_ = false;
+
+    if ( not sender_batch_.empty() ) {
+      ack_sent( receiver_msg );
+    }
+
+    const bool reset = outbound_stream_.reader().has_error() or inbound_reader().has_error();
+    for ( auto& sender_msg : sender_batch_ ) {
+      const bool retransmitted = retransmission( sender_msg );
+      out.push_back( make_segment( std::move( sender_msg ), receiver_msg, reset, retransmitted ) );
+      mark_cwr( out.back(), retransmitted );
+      count_sent( out.back(), retransmitted );
+    }
+    return sender_batch_.size();
+  }
+
+  TCPStats stats() const
+  {
+    TCPStats stats = stats_;
+    stats.segments_retransmitted = sender_.segments_retransmitted();
+    stats.bytes_retransmitted = sender_.bytes_retransmitted();
+    stats.rto_ms = sender_.current_RTO_ms();
+    stats.srtt_ms = sender_.srtt_ms().value_or( 0 );
+    stats.cwnd = sender_.cwnd().value_or( 0 );
+    stats.window_advertised = last_window_sent_;
+    stats.peer_window = sender_.window();
+    stats.sequence_numbers_in_flight = sender_.sequence_numbers_in_flight();
+    return stats;
+  }
+
+  const TCPTrace& trace() const { return trace_; }
+
   // Testing interface
   const TCPReceiver& receiver() const { return receiver_; }
   const TCPSender& sender() const { return sender_; }
   const Reassembler& reassembler() const { return reassembler_; }
+  uint64_t recv_capacity() const { return inbound_stream_.capacity(); }
 };
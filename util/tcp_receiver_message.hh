@@ -2,6 +2,7 @@
 
 #include "wrapping_integers.hh"
 
+#include <cstdint>
 #include <optional>
 
 /*
@@ -13,12 +14,13 @@
  *    This is an optional field that is empty if the TCPReceiver hasn't yet received the Initial Sequence Number.
  *
  * 2) The window size. This is the number of sequence numbers that the TCP receiver is interested
- *    to receive, starting from the ackno if present. The maximum value is 65,535 (UINT16_MAX from
- *    the <cstdint> header).
+ *    to receive, starting from the ackno if present. Without window scaling the maximum value is
+ *    65,535 (UINT16_MAX from the <cstdint> header); with a negotiated window scale (RFC 7323) it can
+ *    be up to 65,535 << 14. In a TCPSegment on the wire, this holds the unscaled 16-bit field.
  */
 
 struct TCPReceiverMessage
 {
   std::optional<Wrap32> ackno {};
-  uint16_t window_size {};
+  uint32_t window_size {};
 };
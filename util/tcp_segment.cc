@@ -2,6 +2,7 @@
 #include "checksum.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <cstddef>
 
 static constexpr uint32_t TCPHeaderMinLen = 5; // 32-bit words
@@ -44,19 +45,22 @@ void TCPSegment::parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum
     receiver_message.ackno.reset(); // no ACK
   }
 
+  cwr = octet & 0b1000'0000;
+  ece = octet & 0b0100'0000;
   reset = octet & 0b0000'0100;
   sender_message.SYN = octet & 0b0000'0010;
   sender_message.FIN = octet & 0b0000'0001;
 
-  parser.integer( receiver_message.window_size );
+  parser.integer( raw16 );
+  receiver_message.window_size = raw16;
   parser.integer( udinfo.cksum );
   parser.integer( raw16 ); // urgent pointer
 
-  // skip any options or anything extra in the header
   if ( data_offset < TCPHeaderMinLen ) {
     parser.set_error();
+    return;
   }
-  parser.remove_prefix( data_offset * 4 - TCPHeaderMinLen * 4 );
+  options.parse( parser, data_offset * 4 - TCPHeaderMinLen * 4 );
 
   parser.all_remaining( sender_message.payload );
 }
@@ -73,16 +77,241 @@ void TCPSegment::serialize( Serializer& serializer ) const
   serializer.integer( udinfo.dst_port );
   serializer.integer( Wrap32Serializable { sender_message.seqno }.raw_value() );
   serializer.integer( Wrap32Serializable { receiver_message.ackno.value_or( Wrap32 { 0 } ) }.raw_value() );
-  serializer.integer( uint8_t { TCPHeaderMinLen << 4 } ); // data offset
-  const uint8_t flags = ( receiver_message.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
+  serializer.integer( static_cast<uint8_t>( header_length() / 4 << 4 ) ); // data offset
+  const uint8_t flags = ( cwr ? 0b1000'0000U : 0 ) | ( ece ? 0b0100'0000U : 0 )
+                        | ( receiver_message.ackno.has_value() ? 0b0001'0000U : 0 ) | ( reset ? 0b0000'0100U : 0 )
                         | ( sender_message.SYN ? 0b0000'0010U : 0 ) | ( sender_message.FIN ? 0b0000'0001U : 0 );
   serializer.integer( flags );
-  serializer.integer( receiver_message.window_size );
+  serializer.integer( static_cast<uint16_t>( min<uint32_t>( receiver_message.window_size, UINT16_MAX ) ) );
   serializer.integer( udinfo.cksum );
   serializer.integer( uint16_t { 0 } ); // urgent pointer
+  options.serialize( serializer );
   serializer.buffer( sender_message.payload );
 }
 
+namespace {
+
+uint16_t load16( const uint8_t* p )
+{
+  return static_cast<uint16_t>( p[0] << 8 | p[1] );
+}
+
+uint32_t load32( const uint8_t* p )
+{
+  return static_cast<uint32_t>( p[0] ) << 24 | static_cast<uint32_t>( p[1] ) << 16
+         | static_cast<uint32_t>( p[2] ) << 8 | p[3];
+}
+
+uint8_t* store16( uint8_t* p, uint16_t v )
+{
+  p[0] = v >> 8;
+  p[1] = v & 0xff;
+  return p + 2;
+}
+
+uint8_t* store32( uint8_t* p, uint32_t v )
+{
+  p[0] = v >> 24;
+  p[1] = ( v >> 16 ) & 0xff;
+  p[2] = ( v >> 8 ) & 0xff;
+  p[3] = v & 0xff;
+  return p + 4;
+}
+
+} // namespace
+
+// Every option is laid out on a four-byte boundary, padded with NOPs in front:
+//   MSS (4) | SACK-permitted + timestamps (12), timestamps (12) or SACK-permitted (4) | window scale (4)
+//   | Fast Open (2 + cookie, padded) | SACK (4 + 8n) | unknown options, then END and zeros up to a multiple of four
+size_t TCPOptions::fixed_length() const
+{
+  size_t len = 0;
+  len += mss.has_value() ? 4 : 0;
+  len += timestamps.has_value() ? TIMESTAMPS_LENGTH : sack_permitted ? 4 : 0;
+  len += window_scale.has_value() ? 4 : 0;
+  len += fast_open.has_value() ? ( 2U + fast_open->length + 3U ) & ~3U : 0;
+  return len;
+}
+
+size_t TCPOptions::sack_blocks_that_fit() const
+{
+  const size_t room = MAX_LENGTH - fixed_length();
+  return room < 12 ? 0 : min<size_t>( sack_block_count, ( room - 4 ) / 8 );
+}
+
+bool TCPOptions::unknown_fits() const
+{
+  const size_t blocks = sack_blocks_that_fit();
+  const size_t used = fixed_length() + ( blocks ? 4 + 8 * blocks : 0 );
+  return used + ( ( unknown_length + 3U ) & ~3U ) <= MAX_LENGTH;
+}
+
+size_t TCPOptions::serialized_length() const
+{
+  const size_t blocks = sack_blocks_that_fit();
+  size_t len = fixed_length() + ( blocks ? 4 + 8 * blocks : 0 );
+  if ( unknown_fits() ) {
+    len += ( unknown_length + 3U ) & ~3U;
+  }
+  return len;
+}
+
+size_t TCPOptions::encode( std::span<uint8_t, MAX_LENGTH> out ) const
+{
+  uint8_t* p = out.data();
+
+  if ( mss.has_value() ) {
+    *p++ = KIND_MSS;
+    *p++ = 4;
+    p = store16( p, mss.value() );
+  }
+
+  if ( timestamps.has_value() ) {
+    if ( sack_permitted ) {
+      *p++ = KIND_SACK_PERMITTED;
+      *p++ = 2;
+    } else {
+      *p++ = KIND_NOP;
+      *p++ = KIND_NOP;
+    }
+    *p++ = KIND_TIMESTAMPS;
+    *p++ = 10;
+    p = store32( p, timestamps->tsval );
+    p = store32( p, timestamps->tsecr );
+  } else if ( sack_permitted ) {
+    *p++ = KIND_NOP;
+    *p++ = KIND_NOP;
+    *p++ = KIND_SACK_PERMITTED;
+    *p++ = 2;
+  }
+
+  if ( window_scale.has_value() ) {
+    *p++ = KIND_NOP;
+    *p++ = KIND_WINDOW_SCALE;
+    *p++ = 3;
+    *p++ = window_scale.value();
+  }
+
+  if ( fast_open.has_value() ) {
+    for ( size_t pad = ( 4 - ( 2 + fast_open->length ) % 4 ) % 4; pad > 0; pad-- ) {
+      *p++ = KIND_NOP;
+    }
+    *p++ = KIND_FAST_OPEN;
+    *p++ = static_cast<uint8_t>( 2 + fast_open->length );
+    p = copy_n( fast_open->bytes.data(), fast_open->length, p );
+  }
+
+  if ( const size_t blocks = sack_blocks_that_fit() ) {
+    *p++ = KIND_NOP;
+    *p++ = KIND_NOP;
+    *p++ = KIND_SACK;
+    *p++ = static_cast<uint8_t>( 2 + 8 * blocks );
+    for ( size_t i = 0; i < blocks; i++ ) {
+      p = store32( p, Wrap32Serializable { sack_blocks[i].left }.raw_value() );
+      p = store32( p, Wrap32Serializable { sack_blocks[i].right }.raw_value() );
+    }
+  }
+
+  if ( unknown_length and unknown_fits() ) {
+    p = copy_n( unknown.data(), unknown_length, p );
+  }
+
+  // END, then zeros up to the next four-byte boundary
+  while ( ( p - out.data() ) % 4 ) {
+    *p++ = KIND_END;
+  }
+  return p - out.data();
+}
+
+// Unknown options are kept (while they fit); a malformed option ends decoding, and the rest of
+// the option space is ignored, as the segment itself is still usable.
+void TCPOptions::decode( std::span<const uint8_t> raw )
+{
+  const uint8_t* p = raw.data();
+  const uint8_t* const end = p + raw.size();
+
+  while ( p < end ) {
+    const uint8_t kind = *p;
+    if ( kind == KIND_END ) {
+      break;
+    }
+    if ( kind == KIND_NOP ) {
+      p++;
+      continue;
+    }
+    if ( end - p < 2 ) {
+      break;
+    }
+    const uint8_t option_length = p[1];
+    if ( option_length < 2 or option_length > end - p ) {
+      break;
+    }
+    const uint8_t* body = p + 2;
+    const size_t body_length = option_length - 2;
+
+    switch ( kind ) {
+      case KIND_MSS:
+        if ( body_length == 2 ) {
+          mss = load16( body );
+        }
+        break;
+      case KIND_WINDOW_SCALE:
+        if ( body_length == 1 ) {
+          window_scale = min( *body, MAX_WINDOW_SCALE );
+        }
+        break;
+      case KIND_SACK_PERMITTED:
+        sack_permitted = true;
+        break;
+      case KIND_SACK:
+        sack_block_count = 0;
+        for ( size_t i = 0; i + 8 <= body_length and sack_block_count < MAX_SACK_BLOCKS; i += 8 ) {
+          sack_blocks[sack_block_count++] = { Wrap32 { load32( body + i ) }, Wrap32 { load32( body + i + 4 ) } };
+        }
+        break;
+      case KIND_TIMESTAMPS:
+        if ( body_length == 8 ) {
+          timestamps = Timestamps { load32( body ), load32( body + 4 ) };
+        }
+        break;
+      case KIND_FAST_OPEN:
+        if ( body_length == 0
+             or ( body_length >= FastOpenCookie::MIN_LENGTH and body_length <= FastOpenCookie::MAX_LENGTH ) ) {
+          fast_open = FastOpenCookie {};
+          copy_n( body, body_length, fast_open->bytes.begin() );
+          fast_open->length = static_cast<uint8_t>( body_length );
+        }
+        break;
+      default:
+        if ( unknown_length + option_length <= MAX_LENGTH ) {
+          copy_n( p, option_length, unknown.begin() + unknown_length );
+          unknown_length += option_length;
+        }
+        break;
+    }
+    p += option_length;
+  }
+}
+
+void TCPOptions::parse( Parser& parser, size_t length )
+{
+  // Copy the whole option space once, then decode from the stack
+  std::array<uint8_t, MAX_LENGTH> raw {};
+  const size_t copied = min( length, MAX_LENGTH );
+  parser.string( { reinterpret_cast<char*>( raw.data() ), copied } ); // NOLINT(*-reinterpret-cast)
+  parser.remove_prefix( length - copied );
+  if ( not parser.has_error() ) {
+    decode( { raw.data(), copied } );
+  }
+}
+
+void TCPOptions::serialize( Serializer& serializer ) const
+{
+  std::array<uint8_t, MAX_LENGTH> raw; // NOLINT(*-member-init)
+  const size_t len = encode( raw );
+  serializer.string( { reinterpret_cast<const char*>( raw.data() ), len } ); // NOLINT(*-reinterpret-cast)
+}
+
 void TCPSegment::compute_checksum( uint32_t datagram_layer_pseudo_checksum )
 {
   udinfo.cksum = 0;
@@ -4,13 +4,104 @@
 #include "tcp_receiver_message.hh"
 #include "tcp_sender_message.hh"
 #include "udinfo.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+
+// TCP header options. Fixed-size and stack-resident: parsing and serializing never allocate.
+// Options minnow does not interpret are kept verbatim and written back out unchanged.
+struct TCPOptions
+{
+  static constexpr size_t MAX_LENGTH = 40; // option space of a header with data offset 15
+
+  static constexpr uint8_t KIND_END = 0;
+  static constexpr uint8_t KIND_NOP = 1;
+  static constexpr uint8_t KIND_MSS = 2;
+  static constexpr uint8_t KIND_WINDOW_SCALE = 3;
+  static constexpr uint8_t KIND_SACK_PERMITTED = 4;
+  static constexpr uint8_t KIND_SACK = 5;
+  static constexpr uint8_t KIND_TIMESTAMPS = 8;
+  static constexpr uint8_t KIND_FAST_OPEN = 34;
+
+  // Maximum segment size (SYN only): the largest payload the sender of this option accepts
+  std::optional<uint16_t> mss {};
+
+  // RFC 7323 window scale (SYN only): shift count the sender applies to the windows it advertises
+  static constexpr uint8_t MAX_WINDOW_SCALE = 14;
+  std::optional<uint8_t> window_scale {};
+
+  // RFC 2018 selective acknowledgments: permitted (SYN only), and the blocks of a SACK option
+  struct SACKBlock
+  {
+    Wrap32 left { 0 };  // first sequence number of the block
+    Wrap32 right { 0 }; // sequence number just past the block
+  };
+  static constexpr size_t MAX_SACK_BLOCKS = 4;
+  bool sack_permitted {};
+  std::array<SACKBlock, MAX_SACK_BLOCKS> sack_blocks {};
+  uint8_t sack_block_count {};
+
+  // RFC 7323 timestamps: the sender's clock (TSval) and the most recent TSval it received (TSecr)
+  struct Timestamps
+  {
+    uint32_t tsval {};
+    uint32_t tsecr {};
+  };
+  std::optional<Timestamps> timestamps {};
+  static constexpr size_t TIMESTAMPS_LENGTH = 12; // NOP, NOP, kind, length, TSval, TSecr
+
+  // RFC 7413 TCP Fast Open cookie (SYN only): empty to request a cookie, 4 to 16 bytes to present one
+  struct FastOpenCookie
+  {
+    static constexpr size_t MIN_LENGTH = 4;
+    static constexpr size_t MAX_LENGTH = 16;
+    std::array<uint8_t, MAX_LENGTH> bytes {};
+    uint8_t length {};
+
+    bool operator==( const FastOpenCookie& other ) const = default;
+  };
+  std::optional<FastOpenCookie> fast_open {};
+
+  // Options minnow does not interpret, as (kind, length, body) records in arrival order
+  std::array<uint8_t, MAX_LENGTH> unknown {};
+  uint8_t unknown_length {};
+
+  // Length in bytes of the serialized options, padded to a multiple of four
+  size_t serialized_length() const;
+
+  // Parse the `length` bytes of option space that follow the fixed header
+  void parse( Parser& parser, size_t length );
+  void serialize( Serializer& serializer ) const;
+
+  // Decode from / encode into raw option bytes. encode() returns the padded length written.
+  void decode( std::span<const uint8_t> raw );
+  size_t encode( std::span<uint8_t, MAX_LENGTH> out ) const;
+
+private:
+  // How many SACK blocks fit beside the other options, and whether the unknown options still fit
+  size_t fixed_length() const;
+  size_t sack_blocks_that_fit() const;
+  bool unknown_fits() const;
+};
 
 struct TCPSegment
 {
+  static constexpr size_t MIN_HEADER_LENGTH = 20; // TCP header length in bytes, without options
+
   TCPSenderMessage sender_message {};
   TCPReceiverMessage receiver_message {};
   bool reset {}; // Connection experienced an abnormal error and should be shut down
+  bool ece {};   // ECN-Echo: the receiver saw congestion experienced (CE) marks (RFC 3168)
+  bool cwr {};   // Congestion Window Reduced: the sender has responded to ECE
+  uint8_t ecn {}; // ECN codepoint of the IP datagram carrying the segment (IPv4Header::ECN_*)
   UserDatagramInfo udinfo {};
+  TCPOptions options {};
+
+  // Length in bytes of the TCP header, including options
+  size_t header_length() const { return MIN_HEADER_LENGTH + options.serialized_length(); }
 
   void parse( Parser& parser, uint32_t datagram_layer_pseudo_checksum );
   void serialize( Serializer& serializer ) const;
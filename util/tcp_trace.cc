@@ -0,0 +1,107 @@
+#include "tcp_trace.hh"
+
+#include <bit>
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+static constexpr uint16_t TRACE_EVENT_LENGTH = 21; // serialized size of an Event
+
+TCPTrace::TCPTrace( const size_t capacity )
+  : events_( capacity == 0 ? 0 : bit_ceil( capacity ) ), mask_( events_.empty() ? 0 : events_.size() - 1 )
+{}
+
+vector<TCPTrace::Event> TCPTrace::events() const
+{
+  vector<Event> out;
+  const uint64_t first = recorded_ > events_.size() ? recorded_ - events_.size() : 0;
+  out.reserve( recorded_ - first );
+  for ( uint64_t i = first; i < recorded_; i++ ) {
+    out.push_back( events_[i & mask_] );
+  }
+  return out;
+}
+
+//! \details Layout: the magic string, the event length (uint16), the number of events recorded in all
+//! (uint64) and the number that follow (uint32); then each event as time_ns (uint64), kind (uint8),
+//! seqno, length and value (uint32 each)
+void TCPTrace::serialize( Serializer& serializer ) const
+{
+  const auto kept = events();
+  serializer.string( MAGIC );
+  serializer.integer( TRACE_EVENT_LENGTH );
+  serializer.integer( recorded_ );
+  serializer.integer( static_cast<uint32_t>( kept.size() ) );
+  for ( const auto& e : kept ) {
+    serializer.integer( e.time_ns );
+    serializer.integer( static_cast<uint8_t>( e.kind ) );
+    serializer.integer( e.seqno );
+    serializer.integer( e.length );
+    serializer.integer( e.value );
+  }
+}
+
+void TCPTrace::dump( const string& path ) const
+{
+  Serializer serializer;
+  serialize( serializer );
+
+  ofstream file { path, ios::binary | ios::trunc };
+  for ( const auto& buffer : serializer.output() ) {
+    file.write( string_view( buffer ).data(), static_cast<streamsize>( buffer.size() ) );
+  }
+  if ( not file.flush() ) {
+    throw runtime_error( "TCPTrace: could not write " + path );
+  }
+}
+
+vector<TCPTrace::Event> TCPTrace::parse( const string_view contents, uint64_t& recorded )
+{
+  Parser parser { { Buffer { string( contents ) } } };
+
+  string magic( MAGIC.size(), '\0' );
+  parser.string( magic );
+  uint16_t event_length = 0;
+  uint32_t count = 0;
+  parser.integer( event_length );
+  parser.integer( recorded );
+  parser.integer( count );
+  if ( parser.has_error() or magic != MAGIC or event_length != TRACE_EVENT_LENGTH
+       or parser.input().size() != uint64_t { count } * TRACE_EVENT_LENGTH ) {
+    throw runtime_error( "TCPTrace: not a trace" );
+  }
+
+  vector<Event> events( count );
+  for ( auto& e : events ) {
+    uint8_t kind = 0;
+    parser.integer( e.time_ns );
+    parser.integer( kind );
+    parser.integer( e.seqno );
+    parser.integer( e.length );
+    parser.integer( e.value );
+    e.kind = static_cast<Kind>( kind );
+  }
+  return events;
+}
+
+string_view TCPTrace::kind_name( const Kind kind )
+{
+  switch ( kind ) {
+    case Kind::Sent:
+      return "sent";
+    case Kind::Retransmitted:
+      return "retransmitted";
+    case Kind::AckReceived:
+      return "ack";
+    case Kind::PeerWindow:
+      return "peer-window";
+    case Kind::OurWindow:
+      return "our-window";
+    case Kind::RtoFired:
+      return "rto";
+    case Kind::OutOfOrder:
+      return "out-of-order";
+  }
+  return "unknown";
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "parser.hh"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A fixed-size ring of compact binary events recording what a TCP connection did, for after-the-fact
+// diagnosis of a stalled or failed transfer.
+//
+// Recording an event is a clock read and a 24-byte store into the ring: nothing is allocated or formatted
+// until the trace is dumped, so a connection can afford to keep one always on. Once the ring is full, each
+// event overwrites the oldest. A dump (see dump()) holds the events oldest first, in network byte order;
+// apps/tcp_trace_decode prints one.
+class TCPTrace
+{
+public:
+  enum class Kind : uint8_t
+  {
+    Sent = 1,      // seqno, sequence length, and the window we advertised
+    Retransmitted, // the same, for a segment below the highest seqno sent
+    AckReceived,   // ackno, sequence numbers it newly acknowledged, and the peer's window
+    PeerWindow,    // the window the peer advertised changed (value: the new window)
+    OurWindow,     // the window we advertise changed (value: the new window)
+    RtoFired,      // the retransmission timer expired (length: consecutive retransmissions; value: new RTO)
+    OutOfOrder,    // seqno and length of data that arrived ahead of the next byte expected (value: how far)
+  };
+
+  struct Event
+  {
+    uint64_t time_ns {}; // steady (monotonic) clock
+    uint32_t seqno {};
+    uint32_t length {};
+    uint32_t value {};
+    Kind kind {};
+  };
+
+  static constexpr std::string_view MAGIC = "MNTRACE1";
+
+private:
+  std::vector<Event> events_ {};
+  uint64_t mask_ {};
+  uint64_t recorded_ {};
+
+public:
+  // A ring of `capacity` events, rounded up to a power of two; 0 records nothing
+  explicit TCPTrace( size_t capacity = 0 );
+
+  bool enabled() const { return not events_.empty(); }
+
+  // Append an event to the ring; without one (tracing off) this does nothing, not even read the clock
+  void record( Kind kind, uint32_t seqno, uint32_t length, uint32_t value )
+  {
+    if ( events_.empty() ) {
+      return;
+    }
+    events_[recorded_++ & mask_] = { now_ns(), seqno, length, value, kind };
+  }
+
+  static uint64_t now_ns()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch() )
+      .count();
+  }
+
+  // Events recorded since construction (the ring keeps the latest of them)
+  uint64_t recorded() const { return recorded_; }
+
+  // The events in the ring, oldest first
+  std::vector<Event> events() const;
+
+  void serialize( Serializer& serializer ) const;
+
+  // Write the trace to a file (replacing it); throws on failure
+  void dump( const std::string& path ) const;
+
+  // Read back what serialize() wrote, setting `recorded` to how many events were recorded in all; throws
+  // if it is not a trace
+  static std::vector<Event> parse( std::string_view contents, uint64_t& recorded );
+
+  static std::string_view kind_name( Kind kind );
+};
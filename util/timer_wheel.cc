@@ -0,0 +1,167 @@
+#include "timer_wheel.hh"
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+
+using namespace std;
+
+TimerWheel::TimerWheel()
+{
+  for ( auto& level : heads_ ) {
+    level.fill( NONE );
+  }
+}
+
+TimerWheel::TimerId TimerWheel::add( const uint64_t owner, const Kind kind )
+{
+  TimerId id = free_list_;
+  if ( id != NONE ) {
+    free_list_ = nodes_[id].next;
+  } else {
+    if ( nodes_.size() >= NONE ) {
+      throw runtime_error( "TimerWheel: too many timers" );
+    }
+    id = static_cast<TimerId>( nodes_.size() );
+    nodes_.emplace_back();
+  }
+
+  nodes_[id] = Node { .owner = owner, .kind = kind, .in_use = true };
+  return id;
+}
+
+void TimerWheel::remove( const TimerId id )
+{
+  if ( not nodes_.at( id ).in_use ) {
+    throw runtime_error( "TimerWheel: remove of unregistered timer" );
+  }
+  cancel( id );
+  nodes_[id] = Node { .next = free_list_ };
+  free_list_ = id;
+}
+
+void TimerWheel::arm( const TimerId id, const uint64_t delay_ms )
+{
+  Node& n = nodes_.at( id );
+  if ( not n.in_use ) {
+    throw runtime_error( "TimerWheel: arm of unregistered timer" );
+  }
+  if ( n.armed ) {
+    unlink( id );
+  } else {
+    n.armed = true;
+    ++armed_count_;
+  }
+  n.expiry = now_ + max( delay_ms, uint64_t { 1 } );
+  link( id );
+}
+
+void TimerWheel::cancel( const TimerId id )
+{
+  Node& n = nodes_.at( id );
+  if ( not n.armed ) {
+    return;
+  }
+  unlink( id );
+  n.armed = false;
+  --armed_count_;
+}
+
+// Place an armed timer on the lowest level whose span reaches its deadline.
+void TimerWheel::link( const TimerId id )
+{
+  Node& n = nodes_[id];
+
+  unsigned level = 0;
+  while ( level + 1 < LEVELS
+          and ( n.expiry >> ( level * SLOT_BITS ) ) - ( now_ >> ( level * SLOT_BITS ) ) >= SLOTS ) {
+    ++level;
+  }
+
+  const unsigned shift = level * SLOT_BITS;
+  uint64_t tick = n.expiry >> shift;
+  if ( tick - ( now_ >> shift ) >= SLOTS ) {
+    tick = ( now_ >> shift ) + SLOTS - 1; // beyond the top level: park in its furthest slot
+  }
+
+  n.level = level;
+  n.slot = tick & SLOT_MASK;
+  n.prev = NONE;
+  n.next = heads_[level][n.slot];
+  if ( n.next != NONE ) {
+    nodes_[n.next].prev = id;
+  }
+  heads_[level][n.slot] = id;
+  occupied_[level] |= uint64_t { 1 } << n.slot;
+}
+
+void TimerWheel::unlink( const TimerId id )
+{
+  Node& n = nodes_[id];
+  if ( n.prev != NONE ) {
+    nodes_[n.prev].next = n.next;
+  } else {
+    heads_[n.level][n.slot] = n.next;
+    if ( n.next == NONE ) {
+      occupied_[n.level] &= ~( uint64_t { 1 } << n.slot );
+    }
+  }
+  if ( n.next != NONE ) {
+    nodes_[n.next].prev = n.prev;
+  }
+  n.prev = n.next = NONE;
+}
+
+// Called when the slot index of `level - 1` has wrapped to zero: redistribute the timers of the
+// current slot of `level` onto the lower levels. Higher levels are cascaded first.
+void TimerWheel::cascade( const unsigned level )
+{
+  if ( level >= LEVELS ) {
+    return;
+  }
+
+  const auto slot = ( now_ >> ( level * SLOT_BITS ) ) & SLOT_MASK;
+  if ( slot == 0 ) {
+    cascade( level + 1 );
+  }
+
+  TimerId id = heads_[level][slot];
+  heads_[level][slot] = NONE;
+  occupied_[level] &= ~( uint64_t { 1 } << slot );
+  while ( id != NONE ) {
+    const TimerId next = nodes_[id].next;
+    link( id );
+    id = next;
+  }
+}
+
+// A timer on level k sits 1 to SLOTS - 1 slots of that level ahead of now_, so the first occupied slot
+// after the current one, found by rotating the bitmap to start there, is the next one due to cascade.
+uint64_t TimerWheel::next_event() const
+{
+  uint64_t next = UINT64_MAX;
+  for ( unsigned level = 0; level < LEVELS; level++ ) {
+    if ( occupied_[level] == 0 ) {
+      continue;
+    }
+    const unsigned shift = level * SLOT_BITS;
+    const uint64_t current = now_ >> shift;
+    const auto from = static_cast<int>( ( current + 1 ) & SLOT_MASK );
+    const auto distance = static_cast<uint64_t>( countr_zero( rotr( occupied_[level], from ) ) ) + 1;
+    next = min( next, ( current + distance ) << shift );
+  }
+  return next;
+}
+
+TimerWheel::TimerId TimerWheel::pop_due()
+{
+  const auto slot = now_ & SLOT_MASK;
+  const TimerId id = heads_[0][slot];
+  if ( id == NONE ) {
+    return NONE;
+  }
+  unlink( id );
+  nodes_[id].armed = false;
+  --armed_count_;
+  return id;
+}
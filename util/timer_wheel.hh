@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A hierarchical timing wheel shared by the timers of many TCP connections.
+//
+// Instead of calling tick() on every connection, each connection registers its timers here once and
+// arms or cancels them as its state changes. Arming and cancelling are O(1) (unlink from / link into an
+// intrusive list), and advance() finds the next slot holding timers (on any level) from per-level
+// occupancy bitmaps and jumps straight to it, so its cost depends on how many timers fall due or cascade,
+// not on how many connections are idle or how much time passes.
+//
+// The wheel has LEVELS levels of SLOTS slots each, with a 1 ms resolution on level 0. A timer due more
+// than SLOTS^k ms away is parked on level k and cascaded down as the wheel turns; deadlines beyond the
+// top level are clamped there and re-cascaded until they fall within range.
+class TimerWheel
+{
+public:
+  // The kinds of per-connection TCP timers the wheel is expected to hold
+  enum class Kind : uint8_t
+  {
+    Retransmission,
+    DelayedAck,
+    Persist,
+    TimeWait,
+    LossDetection, // RACK reordering window and tail loss probe
+  };
+  static constexpr size_t KINDS = 5;
+
+  using TimerId = uint32_t;
+  static constexpr TimerId NONE = UINT32_MAX;
+
+private:
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr unsigned SLOTS = 1U << SLOT_BITS;
+  static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+  static constexpr unsigned LEVELS = 4;
+
+  struct Node
+  {
+    uint64_t expiry {};
+    uint64_t owner {};
+    TimerId prev { NONE };
+    TimerId next { NONE };
+    Kind kind {};
+    uint8_t level {};
+    uint8_t slot {};
+    bool armed {};
+    bool in_use {};
+  };
+
+  uint64_t now_ {};
+  std::vector<Node> nodes_ {};
+  TimerId free_list_ { NONE };
+  size_t armed_count_ {};
+
+  std::array<std::array<TimerId, SLOTS>, LEVELS> heads_ {};
+  std::array<uint64_t, LEVELS> occupied_ {}; // bit i set iff heads_[level][i] is non-empty
+
+  void link( TimerId id );
+  void unlink( TimerId id );
+  void cascade( unsigned level );
+
+  // The earliest time after now_ at which a level-0 slot falls due or a non-empty slot of a higher level
+  // cascades (UINT64_MAX if no timer is armed)
+  uint64_t next_event() const;
+
+  // Detach the first timer of the level-0 slot for the current time; NONE if the slot is empty
+  TimerId pop_due();
+
+public:
+  TimerWheel();
+
+  // Register a (disarmed) timer of the given kind for `owner` (e.g. a connection index)
+  TimerId add( uint64_t owner, Kind kind );
+
+  // Disarm and forget a timer; its id may be handed out again by add()
+  void remove( TimerId id );
+
+  // (Re)arm a timer to fire `delay_ms` from now. A zero delay fires on the next advance().
+  void arm( TimerId id, uint64_t delay_ms );
+
+  // Disarm a timer if it is armed
+  void cancel( TimerId id );
+
+  bool armed( TimerId id ) const { return nodes_.at( id ).armed; }
+  uint64_t expiry( TimerId id ) const { return nodes_.at( id ).expiry; }
+  uint64_t owner( TimerId id ) const { return nodes_.at( id ).owner; }
+  Kind kind( TimerId id ) const { return nodes_.at( id ).kind; }
+
+  uint64_t now() const { return now_; }
+  size_t armed_count() const { return armed_count_; }
+
+  // Move time forward by `ms_since_last_tick`, calling `on_expire( id, owner, kind )` for each timer that
+  // falls due, in deadline order. The callback may arm, cancel or remove any timer, including this one.
+  template<typename F>
+  void advance( uint64_t ms_since_last_tick, F&& on_expire );
+};
+
+template<typename F>
+void TimerWheel::advance( const uint64_t ms_since_last_tick, F&& on_expire )
+{
+  const uint64_t target = now_ + ms_since_last_tick;
+  while ( now_ < target ) {
+    // Jump straight to the next slot that holds timers, or the next cascade that brings some down
+    const uint64_t next = next_event();
+    if ( next > target ) {
+      now_ = target;
+      break;
+    }
+
+    now_ = next;
+    if ( ( now_ & SLOT_MASK ) == 0 ) {
+      cascade( 1 );
+    }
+
+    for ( TimerId id = pop_due(); id != NONE; id = pop_due() ) {
+      const Node& n = nodes_[id];
+      on_expire( id, n.owner, n.kind );
+    }
+  }
+}
@@ -17,6 +17,14 @@ optional<TCPSegment> TCPOverIPv4OverTunFdAdapter::read()
   return {};
 }
 
+//! \param[in] segs the TCPSegments to send, in order
+void TCPOverIPv4OverTunFdAdapter::write( vector<TCPSegment>& segs )
+{
+  for ( auto& seg : segs ) {
+    write( seg );
+  }
+}
+
 //! \param[in] tap Raw network device that will be owned by the adapter
 //! \param[in] eth_address Ethernet address (local address) of the adapter
 //! \param[in] ip_address IP address (local address) of the adapter
@@ -75,6 +83,22 @@ void TCPOverIPv4OverEthernetAdapter::write( TCPSegment& seg )
   send_pending();
 }
 
+//! \param[in] segs the TCPSegments to send, in order
+void TCPOverIPv4OverEthernetAdapter::write( vector<TCPSegment>& segs )
+{
+  for ( auto& seg : segs ) {
+    _interface.send_datagram( wrap_tcp_in_ip( seg ), _next_hop );
+  }
+  send_pending();
+}
+
+//! \param[in] cfg the new configuration, whose MTU the network interface takes on
+void TCPOverIPv4OverEthernetAdapter::set_config( const FdAdapterConfig& cfg )
+{
+  FdAdapterBase::set_config( cfg );
+  _interface.set_mtu( cfg.mtu );
+}
+
 void TCPOverIPv4OverEthernetAdapter::send_pending()
 {
   while ( auto frame = _interface.maybe_send() ) {
@@ -2,6 +2,7 @@
 
 #include "ethernet_header.hh"
 #include "network_interface.hh"
+#include "pcap_fd_adapter.hh"
 #include "tcp_over_ip.hh"
 #include "tcp_segment.hh"
 #include "tun.hh"
@@ -9,6 +10,7 @@
 #include <optional>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TUN device
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter
@@ -26,6 +28,9 @@ public:
   //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
   void write( TCPSegment& seg ) { _tun.write( serialize( wrap_tcp_in_ip( seg ) ) ); }
 
+  //! Writes a batch of TCP segments (a TUN device takes exactly one datagram per write)
+  void write( std::vector<TCPSegment>& segs );
+
   //! Access the underlying TUN device
   explicit operator TunFD&() { return _tun; }
 
@@ -39,6 +44,9 @@ public:
 //! Typedef for TCPOverIPv4OverTunFdAdapter
 using LossyTCPOverIPv4OverTunFdAdapter = LossyFdAdapter<TCPOverIPv4OverTunFdAdapter>;
 
+//! Typedef for TCPOverIPv4OverTunFdAdapter with loss, capturing what the loss leaves
+using LossyPcapTCPOverIPv4OverTunFdAdapter = LossyFdAdapter<PcapFdAdapter<TCPOverIPv4OverTunFdAdapter>>;
+
 //! \brief A FD adapter for IPv4 datagrams read from and written to a TAP device
 class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter
 {
@@ -63,9 +71,18 @@ public:
   //! Sends a TCP segment (in an IPv4 datagram, in an Ethernet frame).
   void write( TCPSegment& seg );
 
+  //! Sends a batch of TCP segments, flushing the resulting frames once at the end.
+  void write( std::vector<TCPSegment>& segs );
+
   //! Called periodically when time elapses
   void tick( size_t ms_since_last_tick );
 
+  //! Replaces the configuration, and limits the network interface to its MTU
+  void set_config( const FdAdapterConfig& cfg );
+
+  //! Datagrams the network interface dropped for exceeding its MTU
+  uint64_t oversized_dropped() const { return _interface.oversized_dropped(); }
+
   //! Access the underlying raw Ethernet connection
   explicit operator TapFD&() { return _tap; }
 